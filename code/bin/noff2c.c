@@ -0,0 +1,705 @@
+/// Program that translates the code of NOFF executables into C.
+///
+/// Every basic block of the code segments of the given files becomes a C
+/// function that has the same effect as interpreting the block.  Compiled
+/// as a shared object, the output can be loaded into Nachos with `-aot`;
+/// for example:
+///
+///     noff2c ../userland/matmult > matmult.c
+///     gcc -O2 -shared -fPIC -I../bin matmult.c -o matmult.so
+///     ./nachos -aot matmult.so -x ../userland/matmult
+///
+/// Blocks are cut exactly where the JIT of the simulator cuts them: after
+/// the delay slot of a branch or jump, right before an instruction that is
+/// not translated (system calls, for instance), and at page boundaries.
+/// One block is generated for every address where execution may enter the
+/// code other than through an indirect jump: the start of every page, the
+/// targets of branches and jumps, the instructions following delay slots
+/// (which is where calls return to) and the ones following untranslated
+/// instructions.  Code reached in any other way is interpreted.
+///
+/// The interface of the generated module is described in `translated.h`.
+///
+/// Copyright (c) 2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "noff.h"
+#include "translated.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+// Must match `PAGE_SIZE` in `machine/mmu.hh`.
+#define PAGE_SIZE  128
+
+#define WORDS_PER_PAGE  (PAGE_SIZE / 4)
+
+#define RET_ADDR_REG  31
+
+enum {
+    OTHER,  // Not translated.
+    ADD, ADDI, ADDIU, ADDU, AND, ANDI, BEQ, BGEZ, BGEZAL, BGTZ, BLEZ, BLTZ,
+    BLTZAL, BNE, DIV, DIVU, J, JAL, JALR, JR, LB, LBU, LH, LHU, LUI, LW,
+    MFHI, MFLO, MTHI, MTLO, MULT, MULTU, NOR, OR, ORI, SB, SH, SLL, SLLV,
+    SLT, SLTI, SLTIU, SLTU, SRA, SRAV, SRL, SRLV, SUB, SUBU, SW, XOR, XORI
+};
+
+typedef struct instruction {
+    uint32_t value;
+    int op;
+    unsigned rs, rt, rd;
+    int32_t extra;  // Immediate, shift amount or jump target, as decoded
+                    // by `Instruction::Decode`.
+} instruction;
+
+typedef struct block {
+    uint32_t pc;
+    unsigned length;
+    bool branch;  // Whether it ends with a branch and its delay slot.
+    unsigned program;
+    const instruction *first;
+} block;
+
+typedef struct program {
+    instruction *code;
+    uint32_t start;  // Virtual address of the code segment.
+    unsigned size;   // Number of instructions.
+} program;
+
+
+static void
+Decode(instruction *in, uint32_t value)
+{
+    static const int SPECIAL[64] = {
+        [0]  = SLL,  [2]  = SRL,   [3]  = SRA,  [4]  = SLLV, [6]  = SRLV,
+        [7]  = SRAV, [8]  = JR,    [9]  = JALR, [16] = MFHI, [17] = MTHI,
+        [18] = MFLO, [19] = MTLO,  [24] = MULT, [25] = MULTU,
+        [26] = DIV,  [27] = DIVU,  [32] = ADD,  [33] = ADDU, [34] = SUB,
+        [35] = SUBU, [36] = AND,   [37] = OR,   [38] = XOR,  [39] = NOR,
+        [42] = SLT,  [43] = SLTU
+    };
+    static const int NORMAL[64] = {
+        [2]  = J,    [3]  = JAL,   [4]  = BEQ,  [5]  = BNE,  [6]  = BLEZ,
+        [7]  = BGTZ, [8]  = ADDI,  [9]  = ADDIU, [10] = SLTI,
+        [11] = SLTIU, [12] = ANDI, [13] = ORI,  [14] = XORI, [15] = LUI,
+        [32] = LB,   [33] = LH,    [35] = LW,   [36] = LBU,  [37] = LHU,
+        [40] = SB,   [41] = SH,    [43] = SW
+    };
+
+    unsigned opcode = value >> 26;
+
+    in->value = value;
+    in->rs    = value >> 21 & 0x1F;
+    in->rt    = value >> 16 & 0x1F;
+    in->rd    = value >> 11 & 0x1F;
+    if (opcode == 0) {
+        in->op    = SPECIAL[value & 0x3F];
+        in->extra = value >> 6 & 0x1F;
+    } else if (opcode == 2 || opcode == 3) {
+        in->op    = NORMAL[opcode];
+        in->extra = value & 0x3FFFFFF;
+    } else {
+        in->extra = (int16_t) (value & 0xFFFF);
+        if (opcode == 1) {
+            switch (value & 0x1F0000) {
+                case 0:        in->op = BLTZ;   break;
+                case 0x10000:  in->op = BGEZ;   break;
+                case 0x100000: in->op = BLTZAL; break;
+                case 0x110000: in->op = BGEZAL; break;
+                default:       in->op = OTHER;  break;
+            }
+        } else
+            in->op = NORMAL[opcode];
+    }
+}
+
+static bool
+IsControlTransfer(const instruction *in)
+{
+    switch (in->op) {
+        case BEQ: case BGEZ: case BGEZAL: case BGTZ: case BLEZ: case BLTZ:
+        case BLTZAL: case BNE: case J: case JAL: case JALR: case JR:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool
+IsLoad(const instruction *in)
+{
+    switch (in->op) {
+        case LB: case LBU: case LH: case LHU: case LW:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool
+AccessesData(const instruction *in)
+{
+    switch (in->op) {
+        case LB: case LBU: case LH: case LHU: case LW: case SB: case SH:
+        case SW:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/// Register written by an instruction, or -1.
+static int
+Destination(const instruction *in)
+{
+    switch (in->op) {
+        case ADD: case ADDU: case AND: case NOR: case OR: case SLL: case SLLV:
+        case SLT: case SLTU: case SRA: case SRAV: case SRL: case SRLV:
+        case SUB: case SUBU: case XOR: case MFHI: case MFLO: case JALR:
+            return in->rd;
+        case ADDI: case ADDIU: case ANDI: case LUI: case ORI: case SLTI:
+        case SLTIU: case XORI:
+            return in->rt;
+        case BGEZAL: case BLTZAL: case JAL:
+            return RET_ADDR_REG;
+        default:
+            return -1;
+    }
+}
+
+/// Target of a branch or direct jump at `pc`, or `pc` itself for indirect
+/// jumps.
+static uint32_t
+Target(const instruction *in, uint32_t pc)
+{
+    switch (in->op) {
+        case J: case JAL:
+            return ((pc + 8) & 0xF0000000) | (uint32_t) in->extra << 2;
+        case JALR: case JR:
+            return pc;
+        default:
+            return pc + 4 + ((uint32_t) in->extra << 2);
+    }
+}
+
+
+/// Writing the C code of a block.
+
+static const block *b;  // The block being written.
+static bool exits[WORDS_PER_PAGE + 1];  // Exits before each instruction
+                                        // that are needed.
+
+static uint32_t
+Address(unsigned i)
+{
+    return b->pc + 4 * i;
+}
+
+static void
+ExitBefore(unsigned i)
+{
+    printf("        goto x%u;\n", i);
+    exits[i] = true;
+}
+
+static void
+Completion(unsigned i, const char *indent)
+{
+    const instruction *in = &b->first[i];
+    bool pending = i > 0 && IsLoad(in - 1);
+    bool zero    = Destination(in) == 0;
+
+    if (pending) {
+        printf("%sr[%u] = r[%u];\n", indent, in[-1].rt,
+               TRANSLATED_LOAD_VALUE_REG);
+        zero = zero || in[-1].rt == 0;
+    }
+    if (IsLoad(in))
+        printf("%sr[%u] = t; r[%u] = %u;\n", indent,
+               TRANSLATED_LOAD_VALUE_REG, TRANSLATED_LOAD_REG, in->rt);
+    else if (pending)
+        printf("%sr[%u] = 0; r[%u] = 0;\n", indent,
+               TRANSLATED_LOAD_VALUE_REG, TRANSLATED_LOAD_REG);
+    if (zero)
+        printf("%sr[0] = 0;\n", indent);
+}
+
+static void
+ExitAfter(unsigned i, const char *indent)
+{
+    if (!b->branch || i < b->length - 1) {
+        printf("%sgoto x%u;\n", indent, i + 1);
+        exits[i + 1] = true;
+        return;
+    }
+
+    // After a delay slot, go to the target of the branch.
+    printf("%sr[%u] = 0x%XU;\n"
+           "%sr[%u] = r[%u];\n"
+           "%sr[%u] = (int32_t) ((uint32_t) r[%u] + 4);\n"
+           "%sreturn %u;\n",
+           indent, TRANSLATED_PREV_PC_REG, Address(i),
+           indent, TRANSLATED_PC_REG, TRANSLATED_NEXT_PC_REG,
+           indent, TRANSLATED_NEXT_PC_REG, TRANSLATED_PC_REG,
+           indent, b->length);
+}
+
+static void
+Branch(unsigned i, const char *condition)
+{
+    const instruction *in = &b->first[i];
+    printf("    r[%u] = %s ? 0x%XU : 0x%XU;\n", TRANSLATED_NEXT_PC_REG,
+           condition, Target(in, Address(i)), Address(i) + 8);
+}
+
+static void
+Read(unsigned i, unsigned size, const char *conversion)
+{
+    const instruction *in = &b->first[i];
+    printf("    v = c->read(c->opaque, (uint32_t) r[%u] + 0x%XU, %u);\n"
+           "    if (v >> 32)\n", in->rs, (uint32_t) in->extra, size);
+    ExitBefore(i);
+    printf("    t = (int32_t) (%s) v;\n", conversion);
+}
+
+static void
+Write(unsigned i, unsigned size)
+{
+    const instruction *in = &b->first[i];
+    printf("    s = c->write(c->opaque, (uint32_t) r[%u] + 0x%XU, r[%u], "
+           "%u);\n"
+           "    if (s == 1)\n", in->rs, (uint32_t) in->extra, in->rt, size);
+    ExitBefore(i);
+    printf("    if (s == 2) {\n");
+    Completion(i, "        ");
+    ExitAfter(i, "        ");
+    printf("    }\n");
+}
+
+static void
+Instruction(unsigned i)
+{
+    const instruction *in = &b->first[i];
+    unsigned rs = in->rs, rt = in->rt, rd = in->rd;
+    uint32_t imm = in->extra;
+
+    printf("    // 0x%X: 0x%08X\n", Address(i), in->value);
+
+    // Writing register zero has no effect, unless there is an exception.
+    if (Destination(in) == 0 && in->op != ADD && in->op != ADDI
+          && in->op != SUB && in->op != JALR)
+        return;
+
+    switch (in->op) {
+        case ADD:
+        case SUB:
+            printf("    a = r[%u]; d = r[%u];\n"
+                   "    s = (int32_t) ((uint32_t) a %c (uint32_t) d);\n"
+                   "    if ((%s(a ^ d) & (a ^ s)) < 0)\n",
+                   rs, rt, in->op == ADD ? '+' : '-',
+                   in->op == ADD ? "~" : "");
+            ExitBefore(i);  // Overflow.
+            printf("    r[%u] = s;\n", rd);
+            break;
+
+        case ADDI:
+            printf("    a = r[%u];\n"
+                   "    s = (int32_t) ((uint32_t) a + 0x%XU);\n"
+                   "    if ((~(a ^ (int32_t) 0x%XU) & (a ^ s)) < 0)\n",
+                   rs, imm, imm);
+            ExitBefore(i);  // Overflow.
+            printf("    r[%u] = s;\n", rt);
+            break;
+
+        case ADDU:
+        case SUBU:
+            printf("    r[%u] = (int32_t) ((uint32_t) r[%u] %c (uint32_t) "
+                   "r[%u]);\n", rd, rs, in->op == ADDU ? '+' : '-', rt);
+            break;
+
+        case AND:
+        case OR:
+        case XOR:
+            printf("    r[%u] = r[%u] %c r[%u];\n", rd, rs,
+                   in->op == AND ? '&' : in->op == OR ? '|' : '^', rt);
+            break;
+
+        case NOR:
+            printf("    r[%u] = ~(r[%u] | r[%u]);\n", rd, rs, rt);
+            break;
+
+        case ADDIU:
+            printf("    r[%u] = (int32_t) ((uint32_t) r[%u] + 0x%XU);\n",
+                   rt, rs, imm);
+            break;
+
+        case ANDI:
+        case ORI:
+        case XORI:
+            printf("    r[%u] = r[%u] %c 0x%X;\n", rt, rs,
+                   in->op == ANDI ? '&' : in->op == ORI ? '|' : '^',
+                   imm & 0xFFFF);
+            break;
+
+        case LUI:
+            printf("    r[%u] = (int32_t) 0x%XU;\n", rt, imm << 16);
+            break;
+
+        case SLL:
+            printf("    r[%u] = (int32_t) ((uint32_t) r[%u] << %u);\n",
+                   rd, rt, imm & 0x1F);
+            break;
+
+        case SRA:
+        case SRL:
+            // The simulator does `SRL` on a signed value too.
+            printf("    r[%u] = r[%u] >> %u;\n", rd, rt, imm & 0x1F);
+            break;
+
+        case SLLV:
+            printf("    r[%u] = (int32_t) ((uint32_t) r[%u] << (r[%u] & 0x1F));"
+                   "\n", rd, rt, rs);
+            break;
+
+        case SRAV:
+        case SRLV:
+            printf("    r[%u] = r[%u] >> (r[%u] & 0x1F);\n", rd, rt, rs);
+            break;
+
+        case SLT:
+            printf("    r[%u] = r[%u] < r[%u];\n", rd, rs, rt);
+            break;
+
+        case SLTU:
+            printf("    r[%u] = (uint32_t) r[%u] < (uint32_t) r[%u];\n",
+                   rd, rs, rt);
+            break;
+
+        case SLTI:
+            printf("    r[%u] = r[%u] < (int32_t) 0x%XU;\n", rt, rs, imm);
+            break;
+
+        case SLTIU:
+            printf("    r[%u] = (uint32_t) r[%u] < 0x%XU;\n", rt, rs, imm);
+            break;
+
+        case MFHI:
+        case MFLO:
+            printf("    r[%u] = r[%u];\n", rd,
+                   in->op == MFHI ? TRANSLATED_HI_REG : TRANSLATED_LO_REG);
+            break;
+
+        case MTHI:
+        case MTLO:
+            printf("    r[%u] = r[%u];\n",
+                   in->op == MTHI ? TRANSLATED_HI_REG : TRANSLATED_LO_REG, rs);
+            break;
+
+        case MULT:
+            printf("    p = (int64_t) r[%u] * r[%u];\n"
+                   "    r[%u] = (int32_t) p; r[%u] = (int32_t) (p >> 32);\n",
+                   rs, rt, TRANSLATED_LO_REG, TRANSLATED_HI_REG);
+            break;
+
+        case MULTU:
+            printf("    p = (int64_t) ((uint64_t) (uint32_t) r[%u]"
+                   " * (uint32_t) r[%u]);\n"
+                   "    r[%u] = (int32_t) p; r[%u] = (int32_t) (p >> 32);\n",
+                   rs, rt, TRANSLATED_LO_REG, TRANSLATED_HI_REG);
+            break;
+
+        case DIV:
+            // Leave division by zero, and the one overflowing case, to the
+            // interpreter.
+            printf("    if (r[%u] == 0 || r[%u] == -1)\n", rt, rt);
+            ExitBefore(i);
+            printf("    a = r[%u]; d = r[%u];\n"
+                   "    r[%u] = a / d; r[%u] = a %% d;\n",
+                   rs, rt, TRANSLATED_LO_REG, TRANSLATED_HI_REG);
+            break;
+
+        case DIVU:
+            printf("    if (r[%u] == 0)\n", rt);
+            ExitBefore(i);
+            printf("    a = r[%u]; d = r[%u];\n"
+                   "    r[%u] = (int32_t) ((uint32_t) a / (uint32_t) d);\n"
+                   "    r[%u] = (int32_t) ((uint32_t) a %% (uint32_t) d);\n",
+                   rs, rt, TRANSLATED_LO_REG, TRANSLATED_HI_REG);
+            break;
+
+        case BEQ:
+        case BNE: {
+            char condition[32];
+            sprintf(condition, "r[%u] %s r[%u]", rs,
+                    in->op == BEQ ? "==" : "!=", rt);
+            Branch(i, condition);
+            break;
+        }
+
+        case BGEZ:
+        case BGEZAL:
+        case BGTZ:
+        case BLEZ:
+        case BLTZ:
+        case BLTZAL: {
+            // The link register is written before the condition is read,
+            // as the simulator does.
+            if (in->op == BGEZAL || in->op == BLTZAL)
+                printf("    r[%u] = 0x%XU;\n", RET_ADDR_REG, Address(i) + 8);
+            char condition[32];
+            sprintf(condition, "r[%u] %s 0", rs,
+                    in->op == BGTZ ? ">" : in->op == BLEZ ? "<="
+                    : in->op == BLTZ || in->op == BLTZAL ? "<" : ">=");
+            Branch(i, condition);
+            break;
+        }
+
+        case J:
+        case JAL:
+            if (in->op == JAL)
+                printf("    r[%u] = 0x%XU;\n", RET_ADDR_REG, Address(i) + 8);
+            printf("    r[%u] = 0x%XU;\n", TRANSLATED_NEXT_PC_REG,
+                   Target(in, Address(i)));
+            break;
+
+        case JALR:
+        case JR:
+            if (in->op == JALR)
+                printf("    r[%u] = 0x%XU;\n", rd, Address(i) + 8);
+            printf("    r[%u] = r[%u];\n", TRANSLATED_NEXT_PC_REG, rs);
+            break;
+
+        case LB:  Read(i, 1, "int8_t");   break;
+        case LBU: Read(i, 1, "uint8_t");  break;
+        case LH:  Read(i, 2, "int16_t");  break;
+        case LHU: Read(i, 2, "uint16_t"); break;
+        case LW:  Read(i, 4, "uint32_t"); break;
+        case SB:  Write(i, 1); break;
+        case SH:  Write(i, 2); break;
+        case SW:  Write(i, 4); break;
+
+        default:
+            abort();
+    }
+}
+
+static void
+WriteBlock(const block *blk, unsigned index)
+{
+    b = blk;
+    for (unsigned i = 0; i <= b->length; i++)
+        exits[i] = false;
+
+    printf("static uint32_t\n"
+           "b%u(int32_t *r, const translatedContext *c)\n"
+           "{\n"
+           "    int32_t a, d, s, t;\n"
+           "    int64_t p, v;\n"
+           "    (void) a; (void) d; (void) s; (void) t; (void) p; (void) v;\n"
+           "\n", index);
+    for (unsigned i = 0; i < b->length; i++) {
+        Instruction(i);
+        Completion(i, "    ");
+    }
+    ExitAfter(b->length - 1, "    ");
+
+    for (unsigned i = 0; i <= b->length; i++) {
+        if (!exits[i])
+            continue;
+        printf("x%u:\n", i);
+        if (i > 0) {
+            printf("    r[%u] = 0x%XU;\n"
+                   "    r[%u] = 0x%XU;\n",
+                   TRANSLATED_PREV_PC_REG, Address(i) - 4,
+                   TRANSLATED_PC_REG, Address(i));
+            if (!IsControlTransfer(&b->first[i - 1]))
+                printf("    r[%u] = 0x%XU;\n",
+                       TRANSLATED_NEXT_PC_REG, Address(i) + 4);
+        }
+        printf("    return %u;\n", i);
+    }
+    printf("}\n\n");
+}
+
+
+/// Finding the blocks.
+
+static bool
+IsTranslated(const instruction *in)
+{
+    return in->op != OTHER;
+}
+
+/// Fill `blk` with the block starting at instruction `offset` of `p`.
+/// Returns false if the block would be empty.
+static bool
+FindBlock(const program *p, unsigned offset, block *blk)
+{
+    uint32_t pc = p->start + 4 * offset;
+    unsigned pageLeft = WORDS_PER_PAGE - pc % PAGE_SIZE / 4;
+    unsigned end = p->size - offset < pageLeft ? p->size : offset + pageLeft;
+
+    blk->pc     = pc;
+    blk->first  = &p->code[offset];
+    blk->length = 0;
+    blk->branch = false;
+    for (unsigned i = offset; i < end; i++) {
+        const instruction *in = &p->code[i];
+        if (!IsTranslated(in))
+            break;
+        if (IsControlTransfer(in)) {
+            if (i + 1 < end && IsTranslated(in + 1)
+                  && !IsControlTransfer(in + 1)) {
+                blk->length += 2;
+                blk->branch = true;
+            }
+            break;
+        }
+        blk->length++;
+    }
+    return blk->length > 0;
+}
+
+static bool
+LoadProgram(const char *path, program *p)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+
+    noffHeader h;
+    if (fread(&h, sizeof h, 1, f) != 1 || h.noffMagic != NOFF_MAGIC
+          || h.code.size % 4 != 0 || h.code.virtualAddr % 4 != 0) {
+        fprintf(stderr, "%s: not a NOFF file\n", path);
+        fclose(f);
+        return false;
+    }
+
+    unsigned char *bytes = malloc(h.code.size);
+    if (bytes == NULL || fseek(f, h.code.inFileAddr, SEEK_SET) != 0
+          || fread(bytes, 1, h.code.size, f) != h.code.size) {
+        fprintf(stderr, "%s: cannot read the code segment\n", path);
+        free(bytes);
+        fclose(f);
+        return false;
+    }
+    fclose(f);
+
+    p->start = h.code.virtualAddr;
+    p->size  = h.code.size / 4;
+    p->code  = malloc(p->size * sizeof *p->code);
+    for (unsigned i = 0; i < p->size; i++) {
+        // User code is little endian.
+        const unsigned char *w = &bytes[4 * i];
+        Decode(&p->code[i], (uint32_t) w[0] | (uint32_t) w[1] << 8
+                            | (uint32_t) w[2] << 16 | (uint32_t) w[3] << 24);
+    }
+    free(bytes);
+    return true;
+}
+
+/// Mark where execution may enter the code of `p`.
+static void
+FindEntries(const program *p, bool *entry)
+{
+    for (unsigned i = 0; i < p->size; i++) {
+        uint32_t pc = p->start + 4 * i;
+        const instruction *in = &p->code[i];
+
+        if (i == 0 || pc % PAGE_SIZE == 0)
+            entry[i] = true;
+        if (!IsTranslated(in) && i + 1 < p->size)
+            entry[i + 1] = true;
+        if (IsControlTransfer(in)) {
+            uint32_t target = Target(in, pc);
+            if (target >= p->start && (target - p->start) / 4 < p->size)
+                entry[(target - p->start) / 4] = true;
+            if (i + 2 < p->size)
+                entry[i + 2] = true;
+        }
+    }
+}
+
+static int
+CompareBlocks(const void *x, const void *y)
+{
+    const block *bx = x, *by = y;
+    if (bx->pc != by->pc)
+        return bx->pc < by->pc ? -1 : 1;
+    return bx->program < by->program ? -1 : bx->program > by->program;
+}
+
+int
+main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <path to NOFF file>...\n", argv[0]);
+        return 1;
+    }
+
+    unsigned numPrograms = argc - 1;
+    program *programs = malloc(numPrograms * sizeof *programs);
+    unsigned maxBlocks = 0;
+    for (unsigned k = 0; k < numPrograms; k++) {
+        if (!LoadProgram(argv[k + 1], &programs[k]))
+            return 1;
+        maxBlocks += programs[k].size;
+    }
+
+    block *blocks = malloc((maxBlocks + 1) * sizeof *blocks);
+    unsigned numBlocks = 0;
+    for (unsigned k = 0; k < numPrograms; k++) {
+        const program *p = &programs[k];
+        bool *entry = calloc(p->size + 1, sizeof *entry);
+        FindEntries(p, entry);
+        for (unsigned i = 0; i < p->size; i++)
+            if (entry[i] && FindBlock(p, i, &blocks[numBlocks])) {
+                blocks[numBlocks].program = k;
+                numBlocks++;
+            }
+        free(entry);
+    }
+    qsort(blocks, numBlocks, sizeof *blocks, CompareBlocks);
+
+    printf("// Generated by `noff2c` from:\n");
+    for (unsigned k = 0; k < numPrograms; k++)
+        printf("//     %s\n", argv[k + 1]);
+    printf("\n#include \"translated.h\"\n\n\n");
+
+    for (unsigned k = 0; k < numPrograms; k++) {
+        const program *p = &programs[k];
+        printf("static const uint32_t code%u[] = {", k);
+        for (unsigned i = 0; i < p->size; i++)
+            printf("%s0x%08XU,", i % 6 == 0 ? "\n    " : " ",
+                   p->code[i].value);
+        printf("\n};\n\n");
+    }
+    for (unsigned n = 0; n < numBlocks; n++)
+        WriteBlock(&blocks[n], n);
+
+    printf("\nconst int %s = %u;\n"
+           "const unsigned %s = %u;\n"
+           "const translatedBlock %s[] = {\n",
+           TRANSLATED_VERSION_SYMBOL, TRANSLATED_VERSION,
+           TRANSLATED_COUNT_SYMBOL, numBlocks, TRANSLATED_BLOCKS_SYMBOL);
+    for (unsigned n = 0; n < numBlocks; n++) {
+        const block *blk = &blocks[n];
+        uint32_t dataAccess = 0;
+        for (unsigned i = 0; i < blk->length; i++)
+            if (AccessesData(&blk->first[i]))
+                dataAccess |= 1U << i;
+        const program *p = &programs[blk->program];
+        printf("    { 0x%XU, %u, 0x%XU, &code%u[%u], b%u },\n",
+               blk->pc, blk->length, dataAccess, blk->program,
+               (unsigned) (blk->first - p->code), n);
+    }
+    // Keep the array non-empty.
+    printf("    { 0, 0, 0, 0, 0 }\n};\n");
+    return 0;
+}
@@ -0,0 +1,69 @@
+/// Interface of the modules produced by `noff2c`.
+///
+/// `noff2c` translates the code segment of NOFF executables into C, one
+/// function per basic block.  Compiled as a shared object, the result can be
+/// handed to Nachos with `-aot`, which then runs those functions instead of
+/// interpreting the same blocks whenever it finds one of them in memory.
+///
+/// A translated block works directly on the simulated registers, and
+/// accesses memory through the callbacks in the context it is given.  It
+/// returns how many instructions it executed, having left the registers,
+/// including the program counters, exactly as the simulator would have left
+/// them after executing that many instructions.
+///
+/// Copyright (c) 2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_BIN_TRANSLATED__H
+#define NACHOS_BIN_TRANSLATED__H
+
+
+#include <stdint.h>
+
+
+// Changes whenever anything in this file changes.
+#define TRANSLATED_VERSION  1
+
+// Registers used by translated code, as numbered in `machine/machine.hh`.
+#define TRANSLATED_HI_REG          32
+#define TRANSLATED_LO_REG          33
+#define TRANSLATED_PC_REG          34
+#define TRANSLATED_NEXT_PC_REG     35
+#define TRANSLATED_PREV_PC_REG     36
+#define TRANSLATED_LOAD_REG        37
+#define TRANSLATED_LOAD_VALUE_REG  38
+
+typedef struct translatedContext {
+    void *opaque;  // Passed back to the callbacks.
+
+    // Return the value read, or a value with bit 32 set if the access
+    // would raise an exception.
+    int64_t (*read)(void *opaque, uint32_t addr, uint32_t size);
+
+    // Return 0 if the write was done, 1 if it would raise an exception,
+    // and 2 if it was done but it changed the code of the running block.
+    int (*write)(void *opaque, uint32_t addr, int32_t value, uint32_t size);
+} translatedContext;
+
+typedef uint32_t (*translatedCode)(int32_t *registers,
+                                   const translatedContext *context);
+
+typedef struct translatedBlock {
+    uint32_t pc;            // Virtual address of the first instruction.
+    uint32_t length;        // Number of instructions.
+    uint32_t dataAccess;    // Bit `i` is set if instruction `i` accesses
+                            // data memory.
+    const uint32_t *words;  // The instructions the block was translated
+                            // from, which must match memory for the block
+                            // to be used.
+    translatedCode code;
+} translatedBlock;
+
+// Every module defines these, with blocks sorted by `pc`.
+#define TRANSLATED_VERSION_SYMBOL  "translatedVersion"
+#define TRANSLATED_COUNT_SYMBOL    "translatedCount"
+#define TRANSLATED_BLOCKS_SYMBOL   "translatedBlocks"
+
+
+#endif
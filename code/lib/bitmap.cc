@@ -78,6 +78,30 @@ Bitmap::Find()
     return -1;
 }
 
+/// Return the first bit of `count` clear bits in a row, aligned to `count`,
+/// and mark them all as in use.
+///
+/// If there is no such run, return -1.
+///
+/// * `count` is the number of bits wanted.
+int
+Bitmap::FindAligned(unsigned count)
+{
+    ASSERT(count > 0);
+
+    for (unsigned first = 0; first + count <= numBits; first += count) {
+        unsigned i = first;
+        while (i < first + count && !Test(i))
+            i++;
+        if (i == first + count) {
+            for (i = first; i < first + count; i++)
+                Mark(i);
+            return first;
+        }
+    }
+    return -1;
+}
+
 /// Return the number of clear bits in the bitmap.  (In other words, how many
 /// bits are unallocated?)
 unsigned
@@ -61,6 +61,12 @@ public:
     /// If no bits are clear, return -1.
     int Find();
 
+    /// Return the index of the first of `count` clear bits in a row,
+    /// starting at a multiple of `count`, and as a side effect, set them.
+    ///
+    /// If there is no such run, return -1.
+    int FindAligned(unsigned count);
+
     /// Return the number of clear bits.
     unsigned CountClear() const;
 
@@ -75,6 +75,9 @@ public:
     /// Remove first item from list.
     Item SortedPop(int *keyPtr);
 
+    /// Look at the key of the first item, without removing it.
+    unsigned SortedFront(int *keyPtr) const;
+
 private:
 
     typedef ListElement<Item> ListNode;
@@ -300,5 +303,31 @@ List<Item>::SortedPop(int *keyPtr)
     return thing;
 }
 
+/// Look at the front of a sorted list.
+///
+/// Returns how many items at the front of the list share the key of the
+/// first one, 0 if the list is empty.
+///
+/// Sets `*keyPtr` to the priority value of the first item, if any.
+///
+/// * `keyPtr` is a pointer to the location in which to store the priority of
+///   the first item.
+template <class Item>
+unsigned
+List<Item>::SortedFront(int *keyPtr) const
+{
+    ASSERT(keyPtr != nullptr);
+
+    if (IsEmpty())
+        return 0;
+
+    unsigned count = 0;
+    for (ListNode *ptr = first; ptr != nullptr && ptr->key == first->key;
+         ptr = ptr->next)
+        count++;
+    *keyPtr = first->key;
+    return count;
+}
+
 
 #endif
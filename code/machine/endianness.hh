@@ -24,4 +24,85 @@ unsigned WordToMachine(unsigned word);
 unsigned short ShortToMachine(unsigned short shortword);
 
 
+#ifdef HOST_IS_BIG_ENDIAN
+const bool HOST_BIG_ENDIAN = true;
+#else
+const bool HOST_BIG_ENDIAN = false;
+#endif
+
+/// Loads and stores of `SIZE` bytes of simulated memory, resolved at
+/// compile time.  `SWAP` tells whether the host byte ordering differs from
+/// the machine's.
+///
+/// Values are loaded as `MMU::ReadMem` always did: bytes are sign-extended,
+/// half words are not.
+template <unsigned SIZE, bool SWAP = HOST_BIG_ENDIAN>
+struct MemoryAccess;
+
+template <bool SWAP>
+struct MemoryAccess<1, SWAP> {
+    static int Load(const char *p)
+    {
+        return *p;
+    }
+
+    static void Store(char *p, int value)
+    {
+        *p = (char) (value & 0xFF);
+    }
+};
+
+template <>
+struct MemoryAccess<2, false> {
+    static int Load(const char *p)
+    {
+        return *(const unsigned short *) p;
+    }
+
+    static void Store(char *p, int value)
+    {
+        *(unsigned short *) p = (unsigned short) (value & 0xFFFF);
+    }
+};
+
+template <>
+struct MemoryAccess<2, true> {
+    static int Load(const char *p)
+    {
+        return __builtin_bswap16(*(const unsigned short *) p);
+    }
+
+    static void Store(char *p, int value)
+    {
+        *(unsigned short *) p = __builtin_bswap16((unsigned short) value);
+    }
+};
+
+template <>
+struct MemoryAccess<4, false> {
+    static int Load(const char *p)
+    {
+        return *(const int *) p;
+    }
+
+    static void Store(char *p, int value)
+    {
+        *(int *) p = value;
+    }
+};
+
+template <>
+struct MemoryAccess<4, true> {
+    static int Load(const char *p)
+    {
+        return (int) __builtin_bswap32(*(const unsigned *) p);
+    }
+
+    static void Store(char *p, int value)
+    {
+        *(unsigned *) p = __builtin_bswap32((unsigned) value);
+    }
+};
+
+
 #endif
@@ -68,3 +68,25 @@ Instruction::RegFromType(RegType t) const
             return -1;
     }
 }
+
+bool
+Instruction::IsControlTransfer() const
+{
+    switch (opCode) {
+        case OP_BEQ:
+        case OP_BGEZ:
+        case OP_BGEZAL:
+        case OP_BGTZ:
+        case OP_BLEZ:
+        case OP_BLTZ:
+        case OP_BLTZAL:
+        case OP_BNE:
+        case OP_J:
+        case OP_JAL:
+        case OP_JALR:
+        case OP_JR:
+            return true;
+        default:
+            return false;
+    }
+}
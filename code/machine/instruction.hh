@@ -25,6 +25,10 @@ public:
     /// Retrieve the register number referred to in an instruction.
     int RegFromType(RegType reg) const;
 
+    /// Return true if this is a branch or a jump, that is, if it is
+    /// followed by a delay slot.
+    bool IsControlTransfer() const;
+
     unsigned value;  //< Binary representation of the instruction.
 
     unsigned char opCode;  ///< Type of instruction.  This is NOT the same as
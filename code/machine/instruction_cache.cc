@@ -0,0 +1,69 @@
+/// Routines to manage the cache of decoded user instructions.
+///
+/// Copyright (c) 2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "instruction_cache.hh"
+#include "endianness.hh"
+#include "lib/utility.hh"
+
+
+InstructionCache::InstructionCache(unsigned numFrames_, unsigned frameSize)
+{
+    ASSERT(frameSize % 4 == 0);
+
+    numFrames     = numFrames_;
+    wordsPerFrame = frameSize / 4;
+    decoded       = new Instruction [numFrames * wordsPerFrame];
+    cached        = new bool [numFrames];
+    versions      = new unsigned [numFrames];
+    for (unsigned i = 0; i < numFrames; i++)
+        versions[i] = 0;
+    InvalidateAll();
+}
+
+InstructionCache::~InstructionCache()
+{
+    delete [] decoded;
+    delete [] cached;
+    delete [] versions;
+}
+
+const Instruction *
+InstructionCache::GetFrame(unsigned frame, const char *memory)
+{
+    ASSERT(frame < numFrames);
+    ASSERT(memory != nullptr);
+
+    Instruction *page = &decoded[frame * wordsPerFrame];
+    if (cached[frame])
+        return page;
+
+    DEBUG('m', "Decoding physical page %u\n", frame);
+    const unsigned *words = (const unsigned *) &memory[frame * wordsPerFrame
+                                                        * 4];
+    for (unsigned i = 0; i < wordsPerFrame; i++) {
+        page[i].value = WordToHost(words[i]);
+        page[i].Decode();
+    }
+    cached[frame] = true;
+    versions[frame]++;
+    return page;
+}
+
+void
+InstructionCache::Invalidate(unsigned frame)
+{
+    ASSERT(frame < numFrames);
+
+    cached[frame] = false;
+}
+
+void
+InstructionCache::InvalidateAll()
+{
+    for (unsigned i = 0; i < numFrames; i++)
+        cached[i] = false;
+}
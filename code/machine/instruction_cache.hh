@@ -0,0 +1,83 @@
+/// Data structures to keep already decoded user instructions around.
+///
+/// Decoding a MIPS instruction is not expensive by itself, but the simulator
+/// does it once per executed instruction, so tight user loops end up
+/// decoding the very same words over and over.  This cache keeps the
+/// decoded form of every instruction fetched from a physical page, indexed
+/// by the word offset inside that page.
+///
+/// The cache is keyed by *physical* page, so it stays valid across context
+/// switches and it is shared between address spaces.  On the other hand,
+/// it must be told whenever the contents of a physical page change: the MMU
+/// takes care of user stores, and the kernel must call
+/// `MMU::InvalidateFrame` whenever it writes a frame directly (for example,
+/// when loading a page from the executable or from swap).
+///
+/// Copyright (c) 2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_MACHINE_INSTRUCTIONCACHE__HH
+#define NACHOS_MACHINE_INSTRUCTIONCACHE__HH
+
+
+#include "instruction.hh"
+
+
+class InstructionCache {
+public:
+
+    /// Create an empty cache for `numFrames` physical pages of
+    /// `frameSize` bytes each.
+    InstructionCache(unsigned numFrames, unsigned frameSize);
+
+    ~InstructionCache();
+
+    /// Return the decoded instructions of the physical page `frame`.
+    ///
+    /// If the page is not cached yet, every word of it is decoded from
+    /// `memory` (which points to the beginning of `mainMemory`).  The
+    /// returned array has one entry per word of the page.
+    const Instruction *GetFrame(unsigned frame, const char *memory);
+
+    /// Forget the decoded contents of physical page `frame`.
+    void Invalidate(unsigned frame);
+
+    /// Forget everything.
+    void InvalidateAll();
+
+    /// Return true if `frame` currently holds decoded instructions.
+    bool IsCached(unsigned frame) const
+    {
+        return cached[frame];
+    }
+
+    /// Return how many times `frame` has been decoded so far.
+    ///
+    /// Clients that derive their own data from a decoded page can compare
+    /// versions to tell whether that data is still current.
+    unsigned GetVersion(unsigned frame) const
+    {
+        return versions[frame];
+    }
+
+private:
+
+    /// Number of physical pages covered.
+    unsigned numFrames;
+
+    /// Number of instructions per physical page.
+    unsigned wordsPerFrame;
+
+    /// Decoded instructions, `wordsPerFrame` per physical page.
+    Instruction *decoded;
+
+    /// Whether the corresponding page in `decoded` is up to date.
+    bool *cached;
+
+    /// Number of times each page has been decoded.
+    unsigned *versions;
+};
+
+
+#endif
@@ -141,10 +141,13 @@ Interrupt::Enable()
 /// Two things can cause `OneTick` to be called:
 /// * interrupts are re-enabled;
 /// * a user instruction is executed.
-void
+///
+/// Returns true if some interrupt handler was invoked.
+bool
 Interrupt::OneTick()
 {
     MachineStatus old = status;
+    bool fired = false;
 
     // Advance simulated time.
     if (status == SYSTEM_MODE) {
@@ -160,7 +163,7 @@ Interrupt::OneTick()
     ChangeLevel(INT_ON, INT_OFF);  // First, turn off interrupts (interrupt
                                    // handlers run with interrupts disabled).
     while (CheckIfDue(false))      // Check for pending interrupts.
-        ;
+        fired = true;
     ChangeLevel(INT_OFF, INT_ON);  // Re-enable interrupts.
     if (yieldOnReturn) {           // If the timer device handler asked for a
                                    // context switch, ok to do it now.
@@ -169,6 +172,41 @@ Interrupt::OneTick()
         currentThread->Yield();
         status = old;
     }
+    return fired;
+}
+
+unsigned long
+Interrupt::InstructionsBeforeDue() const
+{
+    if (status != USER_MODE || level != INT_ON || yieldOnReturn
+          || debug.IsEnabled('i'))
+        return 0;
+
+    unsigned when;
+    if (pending->SortedFront((int *) &when) == 0)
+        return ULONG_MAX;
+    if (when <= stats->totalTicks)
+        return 0;
+    return (when - stats->totalTicks - 1) / USER_TICK;
+}
+
+void
+Interrupt::AdvanceInstructions(unsigned long count)
+{
+    ASSERT(count <= InstructionsBeforeDue());
+
+    stats->totalTicks += count * USER_TICK;
+    stats->userTicks  += count * USER_TICK;
+
+    // On every tick, `CheckIfDue` takes out the first pending interrupt and
+    // puts it back behind the others due at the same time.  Keep the same
+    // order here.
+    unsigned when;
+    unsigned ties = pending->SortedFront((int *) &when);
+    for (unsigned long i = 0; ties > 1 && i < count % ties; i++) {
+        PendingInterrupt *first = pending->SortedPop((int *) &when);
+        pending->SortedInsert(first, when);
+    }
 }
 
 /// Called from within an interrupt handler, to cause a context switch (for
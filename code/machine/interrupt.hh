@@ -143,7 +143,22 @@ public:
                   unsigned long when, IntType type);
 
     /// Advance simulated time.
-    void OneTick();
+    ///
+    /// Returns true if any interrupt handler was invoked (and so the
+    /// current thread may have been switched out in the meantime).
+    bool OneTick();
+
+    /// Return how many user instructions can be run before a pending
+    /// interrupt becomes due, or 0 if `OneTick` has to be called after the
+    /// next one.
+    unsigned long InstructionsBeforeDue() const;
+
+    /// Advance simulated time for `count` user instructions at once, as
+    /// `count` calls to `OneTick` would.
+    ///
+    /// No interrupt may become due in the meantime; see
+    /// `InstructionsBeforeDue`.
+    void AdvanceInstructions(unsigned long count);
 
 private:
     IntStatus level;  ///< Are interrupts enabled or disabled?
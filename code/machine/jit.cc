@@ -0,0 +1,1053 @@
+/// Routines to translate hot user code into x86-64 host code.
+///
+/// A translated block is a function that takes the simulated registers in
+/// `rbx` and the `JitContext` in `r12`.  Every instruction loads its
+/// operands from the register array and stores its result back, so the
+/// simulated state is exact between any two instructions; only the program
+/// counters are left alone until the block exits.  Every exit stores them
+/// and returns how many instructions ran, so that the caller can advance
+/// simulated time.
+///
+/// Delayed loads are done exactly as `Machine::DelayedLoad` does them: the
+/// value loaded goes into `LOAD_VALUE_REG` and reaches its register only
+/// after the next instruction.  For that reason a block may only be
+/// entered with no delayed load pending.
+///
+/// Copyright (c) 2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "jit.hh"
+#include "machine.hh"
+#include "mmu_access.hh"
+#include "threads/system.hh"
+
+#include <dlfcn.h>
+#include <string.h>
+#ifdef __x86_64__
+#include <sys/mman.h>
+#endif
+
+
+static const unsigned WORDS_PER_PAGE = PAGE_SIZE / 4;
+
+static_assert(TRANSLATED_HI_REG == HI_REG && TRANSLATED_LO_REG == LO_REG
+                && TRANSLATED_PC_REG == PC_REG
+                && TRANSLATED_NEXT_PC_REG == NEXT_PC_REG
+                && TRANSLATED_PREV_PC_REG == PREV_PC_REG
+                && TRANSLATED_LOAD_REG == LOAD_REG
+                && TRANSLATED_LOAD_VALUE_REG == LOAD_VALUE_REG,
+              "`translated.h` does not match the registers of the machine");
+
+/// Times a block must be entered before it gets translated.
+static const unsigned HOT_THRESHOLD = 50;
+
+/// Size of the buffer for translated code, and room needed by one block.
+static const unsigned CODE_SIZE      = 4 * 1024 * 1024;
+static const unsigned MAX_BLOCK_CODE = 16 * 1024;
+
+
+/// Memory accesses of translated code.
+///
+/// Before the access, the page of the running block is made the most
+/// recently used one, as the fetch of the instruction would have done.
+
+/// Return the value read, or a value with bit 32 set if the access would
+/// raise an exception.
+template <TranslationMode MODE, unsigned SIZE>
+static long long
+JitRead(JitContext *context, unsigned addr)
+{
+    int value;
+
+    context->mmu->RepeatFetch(0);
+    if (!context->mmu->TryReadMem<MODE, SIZE>(addr, &value))
+        return 1LL << 32;
+    return (unsigned) value;
+}
+
+/// Return 0 if the write was done, 1 if it would raise an exception, and 2
+/// if it was done but it changed the code of the running block.
+template <TranslationMode MODE, unsigned SIZE>
+static int
+JitWrite(JitContext *context, unsigned addr, int value)
+{
+    context->mmu->RepeatFetch(0);
+    if (!context->mmu->TryWriteMem<MODE, SIZE>(addr, value))
+        return 1;
+    return context->mmu->GetInstructionCache()->IsCached(context->frame)
+           ? 0 : 2;
+}
+
+/// The same, for blocks of a module, which pass the size along.
+
+template <TranslationMode MODE>
+static int64_t
+ModuleRead(void *opaque, uint32_t addr, uint32_t size)
+{
+    JitContext *context = (JitContext *) opaque;
+    switch (size) {
+        case 1:  return JitRead<MODE, 1>(context, addr);
+        case 2:  return JitRead<MODE, 2>(context, addr);
+        default: return JitRead<MODE, 4>(context, addr);
+    }
+}
+
+template <TranslationMode MODE>
+static int
+ModuleWrite(void *opaque, uint32_t addr, int32_t value, uint32_t size)
+{
+    JitContext *context = (JitContext *) opaque;
+    switch (size) {
+        case 1:  return JitWrite<MODE, 1>(context, addr, value);
+        case 2:  return JitWrite<MODE, 2>(context, addr, value);
+        default: return JitWrite<MODE, 4>(context, addr, value);
+    }
+}
+
+/// Point `readers` and `writers` at the accesses of each size, indexed by
+/// `size / 2`, and the module at its own ones.
+template <TranslationMode MODE>
+static void
+SelectAccesses(const void **readers, const void **writers,
+               translatedContext *module)
+{
+    readers[0] = (const void *) JitRead<MODE, 1>;
+    readers[1] = (const void *) JitRead<MODE, 2>;
+    readers[2] = (const void *) JitRead<MODE, 4>;
+    writers[0] = (const void *) JitWrite<MODE, 1>;
+    writers[1] = (const void *) JitWrite<MODE, 2>;
+    writers[2] = (const void *) JitWrite<MODE, 4>;
+    module->read  = ModuleRead<MODE>;
+    module->write = ModuleWrite<MODE>;
+}
+
+
+#ifdef __x86_64__
+
+/// Host registers, as encoded in instructions.
+enum {
+    EAX = 0,
+    ECX = 1,
+    EDX = 2,
+    EBX = 3,
+    ESI = 6
+};
+
+/// Condition codes.
+enum {
+    CC_O  = 0x0,
+    CC_B  = 0x2,
+    CC_E  = 0x4,
+    CC_NE = 0x5,
+    CC_S  = 0x8,
+    CC_NS = 0x9,
+    CC_L  = 0xC,
+    CC_LE = 0xE,
+    CC_G  = 0xF
+};
+
+/// Opcodes of two-operand arithmetic with a memory source, and the
+/// corresponding extension of the immediate forms.
+enum {
+    ALU_ADD = 0x03,
+    ALU_OR  = 0x0B,
+    ALU_AND = 0x23,
+    ALU_SUB = 0x2B,
+    ALU_XOR = 0x33,
+    ALU_CMP = 0x3B
+};
+
+enum {
+    EXT_ADD = 0,
+    EXT_OR  = 1,
+    EXT_AND = 4,
+    EXT_XOR = 6,
+    EXT_CMP = 7
+};
+
+/// Writes x86-64 machine code into a buffer.
+///
+/// Simulated register `r` is at `[rbx + 4 * r]`.
+class Emitter {
+public:
+    Emitter(unsigned char *start)
+    {
+        p = start;
+    }
+
+    void Byte(unsigned b)
+    {
+        *p++ = b;
+    }
+
+    void Bytes(unsigned b1, unsigned b2)
+    {
+        Byte(b1);
+        Byte(b2);
+    }
+
+    void Bytes(unsigned b1, unsigned b2, unsigned b3)
+    {
+        Byte(b1);
+        Byte(b2);
+        Byte(b3);
+    }
+
+    void Word(unsigned w)
+    {
+        memcpy(p, &w, 4);
+        p += 4;
+    }
+
+    void Quad(unsigned long long q)
+    {
+        memcpy(p, &q, 8);
+        p += 8;
+    }
+
+    /// `mov host, [reg]`.
+    void Load(unsigned host, unsigned reg)
+    {
+        Bytes(0x8B, 0x80 | host << 3 | EBX);
+        Word(reg * 4);
+    }
+
+    /// `mov [reg], host`.
+    void Store(unsigned reg, unsigned host)
+    {
+        Bytes(0x89, 0x80 | host << 3 | EBX);
+        Word(reg * 4);
+    }
+
+    /// `mov dword [reg], imm`; always 10 bytes long.
+    void StoreImm(unsigned reg, int imm)
+    {
+        Bytes(0xC7, 0x83);
+        Word(reg * 4);
+        Word(imm);
+    }
+
+    /// `op host, [reg]`.
+    void Alu(unsigned op, unsigned host, unsigned reg)
+    {
+        Bytes(op, 0x80 | host << 3 | EBX);
+        Word(reg * 4);
+    }
+
+    /// `op host, imm`.
+    void AluImm(unsigned ext, unsigned host, int imm)
+    {
+        Bytes(0x81, 0xC0 | ext << 3 | host);
+        Word(imm);
+    }
+
+    /// `movsxd host64, [reg]`.
+    void LoadSigned64(unsigned host, unsigned reg)
+    {
+        Bytes(0x48, 0x63, 0x80 | host << 3 | EBX);
+        Word(reg * 4);
+    }
+
+    /// `jcc rel32`, returning where the displacement must be patched.
+    unsigned char *Jump(unsigned cc)
+    {
+        Bytes(0x0F, 0x80 | cc);
+        Word(0);
+        return p - 4;
+    }
+
+    /// `call function`, with arguments already in place.
+    void Call(const void *function)
+    {
+        Bytes(0x4C, 0x89, 0xE7);  // mov rdi, r12
+        Bytes(0x48, 0xB8);        // mov rax, function
+        Quad((unsigned long long) function);
+        Bytes(0xFF, 0xD0);        // call rax
+    }
+
+    /// Return `count` from the block.
+    void Return(unsigned count)
+    {
+        if (count == 0)
+            Bytes(0x31, 0xC0);  // xor eax, eax
+        else {
+            Byte(0xB8);         // mov eax, count
+            Word(count);
+        }
+        Bytes(0x48, 0x83, 0xC4); Byte(0x08);  // add rsp, 8
+        Bytes(0x41, 0x5C);                     // pop r12
+        Byte(0x5B);                            // pop rbx
+        Byte(0xC3);                            // ret
+    }
+
+    static void Patch(unsigned char *at, const unsigned char *target)
+    {
+        int displacement = target - (at + 4);
+        memcpy(at, &displacement, 4);
+    }
+
+    unsigned char *p;
+};
+
+/// A jump from the body of a block to one of its exits.
+struct JitExit {
+    unsigned char *patch;
+    bool store;      ///< Whether the exit follows a store (status in
+                     ///< `eax`), or is just before an instruction.
+    unsigned index;  ///< Instruction the exit refers to.
+};
+
+/// Everything needed while translating one block.
+class BlockTranslator {
+public:
+    BlockTranslator(unsigned char *start, unsigned pc_,
+                    const Instruction *first_, unsigned length_,
+                    bool branch_, const void *const *readers_,
+                    const void *const *writers_)
+      : e(start)
+    {
+        pc       = pc_;
+        first    = first_;
+        length   = length_;
+        branch   = branch_;
+        readers  = readers_;
+        writers  = writers_;
+        numExits = 0;
+    }
+
+    /// Emit the whole block.  Returns the end of the code.
+    unsigned char *Emit();
+
+private:
+
+    unsigned Address(unsigned i) const
+    {
+        return pc + 4 * i;
+    }
+
+    bool IsLoad(unsigned i) const;
+
+    /// Register written by instruction `i`, or -1.
+    int Destination(unsigned i) const;
+
+    void EmitInstruction(unsigned i);
+    void EmitBranch(unsigned i, unsigned skip);
+    void EmitRead(unsigned i, unsigned size);
+    void EmitWrite(unsigned i, unsigned size);
+
+    /// Finish instruction `i`: delayed load and register zero.
+    void EmitCompletion(unsigned i);
+
+    void EmitExitBefore(unsigned i);
+    void EmitExitAfter(unsigned i);
+    void EmitExitStore(unsigned i);
+
+    void AddExit(unsigned char *patch, bool store, unsigned index)
+    {
+        ASSERT(numExits < MAX_EXITS);
+        exits[numExits].patch = patch;
+        exits[numExits].store = store;
+        exits[numExits].index = index;
+        numExits++;
+    }
+
+    static const unsigned MAX_EXITS = 4 * WORDS_PER_PAGE;
+
+    Emitter e;
+    unsigned pc;
+    const Instruction *first;
+    unsigned length;
+    bool branch;  ///< Whether the block ends with a branch and its slot.
+    const void *const *readers;  ///< Accesses to call, by `size / 2`.
+    const void *const *writers;
+    JitExit exits[MAX_EXITS];
+    unsigned numExits;
+};
+
+bool
+BlockTranslator::IsLoad(unsigned i) const
+{
+    switch (first[i].opCode) {
+        case OP_LB:
+        case OP_LBU:
+        case OP_LH:
+        case OP_LHU:
+        case OP_LW:
+            return true;
+        default:
+            return false;
+    }
+}
+
+int
+BlockTranslator::Destination(unsigned i) const
+{
+    const Instruction *in = &first[i];
+    switch (in->opCode) {
+        case OP_ADD: case OP_ADDU: case OP_AND: case OP_NOR: case OP_OR:
+        case OP_SLL: case OP_SLLV: case OP_SLT: case OP_SLTU: case OP_SRA:
+        case OP_SRAV: case OP_SRL: case OP_SRLV: case OP_SUB: case OP_SUBU:
+        case OP_XOR: case OP_MFHI: case OP_MFLO: case OP_JALR:
+            return in->rd;
+        case OP_ADDI: case OP_ADDIU: case OP_ANDI: case OP_LUI: case OP_ORI:
+        case OP_SLTI: case OP_SLTIU: case OP_XORI:
+            return in->rt;
+        case OP_BGEZAL: case OP_BLTZAL: case OP_JAL:
+            return RET_ADDR_REG;
+        default:
+            return -1;
+    }
+}
+
+unsigned char *
+BlockTranslator::Emit()
+{
+    e.Byte(0x53);                          // push rbx
+    e.Bytes(0x41, 0x54);                   // push r12
+    e.Bytes(0x48, 0x83, 0xEC); e.Byte(8);  // sub rsp, 8
+    e.Bytes(0x48, 0x89, 0xFB);             // mov rbx, rdi
+    e.Bytes(0x49, 0x89, 0xF4);             // mov r12, rsi
+
+    for (unsigned i = 0; i < length; i++) {
+        EmitInstruction(i);
+        EmitCompletion(i);
+    }
+    EmitExitAfter(length - 1);
+
+    // Exits may add more exits, so no iterators here.
+    for (unsigned k = 0; k < numExits; k++) {
+        Emitter::Patch(exits[k].patch, e.p);
+        if (exits[k].store)
+            EmitExitStore(exits[k].index);
+        else
+            EmitExitBefore(exits[k].index);
+    }
+    return e.p;
+}
+
+void
+BlockTranslator::EmitInstruction(unsigned i)
+{
+    const Instruction *in = &first[i];
+
+    switch (in->opCode) {
+        case OP_ADD:
+        case OP_SUB:
+            e.Load(EAX, in->rs);
+            e.Alu(in->opCode == OP_ADD ? ALU_ADD : ALU_SUB, EAX, in->rt);
+            AddExit(e.Jump(CC_O), false, i);  // Overflow.
+            e.Store(in->rd, EAX);
+            break;
+
+        case OP_ADDU:
+        case OP_SUBU:
+        case OP_AND:
+        case OP_OR:
+        case OP_XOR:
+        case OP_NOR: {
+            unsigned op = in->opCode == OP_ADDU ? ALU_ADD
+                        : in->opCode == OP_SUBU ? ALU_SUB
+                        : in->opCode == OP_AND  ? ALU_AND
+                        : in->opCode == OP_XOR  ? ALU_XOR : ALU_OR;
+            e.Load(EAX, in->rs);
+            e.Alu(op, EAX, in->rt);
+            if (in->opCode == OP_NOR)
+                e.Bytes(0xF7, 0xD0);  // not eax
+            e.Store(in->rd, EAX);
+            break;
+        }
+
+        case OP_ADDI:
+            e.Load(EAX, in->rs);
+            e.AluImm(EXT_ADD, EAX, in->extra);
+            AddExit(e.Jump(CC_O), false, i);  // Overflow.
+            e.Store(in->rt, EAX);
+            break;
+
+        case OP_ADDIU:
+            e.Load(EAX, in->rs);
+            e.AluImm(EXT_ADD, EAX, in->extra);
+            e.Store(in->rt, EAX);
+            break;
+
+        case OP_ANDI:
+        case OP_ORI:
+        case OP_XORI:
+            e.Load(EAX, in->rs);
+            e.AluImm(in->opCode == OP_ANDI ? EXT_AND
+                     : in->opCode == OP_ORI ? EXT_OR : EXT_XOR,
+                     EAX, in->extra & 0xFFFF);
+            e.Store(in->rt, EAX);
+            break;
+
+        case OP_LUI:
+            e.StoreImm(in->rt, in->extra << 16);
+            break;
+
+        case OP_SLL:
+        case OP_SRA:
+        case OP_SRL:
+            // `ExecInstruction` does `SRL` on a signed value too.
+            e.Load(EAX, in->rt);
+            e.Bytes(0xC1, in->opCode == OP_SLL ? 0xE0 : 0xF8, in->extra & 0x1F);
+            e.Store(in->rd, EAX);
+            break;
+
+        case OP_SLLV:
+        case OP_SRAV:
+        case OP_SRLV:
+            e.Load(ECX, in->rs);
+            e.Bytes(0x83, 0xE1, 0x1F);  // and ecx, 0x1F
+            e.Load(EAX, in->rt);
+            e.Bytes(0xD3, in->opCode == OP_SLLV ? 0xE0 : 0xF8);
+            e.Store(in->rd, EAX);
+            break;
+
+        case OP_SLT:
+        case OP_SLTU:
+            e.Load(EAX, in->rs);
+            e.Alu(ALU_CMP, EAX, in->rt);
+            e.Bytes(0x0F, 0x90 | (in->opCode == OP_SLT ? CC_L : CC_B), 0xC0);
+            e.Bytes(0x0F, 0xB6, 0xC0);  // movzx eax, al
+            e.Store(in->rd, EAX);
+            break;
+
+        case OP_SLTI:
+        case OP_SLTIU:
+            e.Load(EAX, in->rs);
+            e.AluImm(EXT_CMP, EAX, in->extra);
+            e.Bytes(0x0F, 0x90 | (in->opCode == OP_SLTI ? CC_L : CC_B), 0xC0);
+            e.Bytes(0x0F, 0xB6, 0xC0);  // movzx eax, al
+            e.Store(in->rt, EAX);
+            break;
+
+        case OP_MFHI:
+        case OP_MFLO:
+            e.Load(EAX, in->opCode == OP_MFHI ? HI_REG : LO_REG);
+            e.Store(in->rd, EAX);
+            break;
+
+        case OP_MTHI:
+        case OP_MTLO:
+            e.Load(EAX, in->rs);
+            e.Store(in->opCode == OP_MTHI ? HI_REG : LO_REG, EAX);
+            break;
+
+        case OP_MULT:
+        case OP_MULTU:
+            if (in->opCode == OP_MULT) {
+                e.LoadSigned64(EAX, in->rs);
+                e.LoadSigned64(ECX, in->rt);
+            } else {
+                e.Load(EAX, in->rs);
+                e.Load(ECX, in->rt);
+            }
+            e.Bytes(0x48, 0x0F, 0xAF); e.Byte(0xC1);  // imul rax, rcx
+            e.Store(LO_REG, EAX);
+            e.Bytes(0x48, 0xC1, 0xE8); e.Byte(32);    // shr rax, 32
+            e.Store(HI_REG, EAX);
+            break;
+
+        case OP_DIV:
+        case OP_DIVU:
+            // Leave division by zero, and the one overflowing case, to the
+            // interpreter.
+            e.Load(ECX, in->rt);
+            e.Bytes(0x85, 0xC9);  // test ecx, ecx
+            AddExit(e.Jump(CC_E), false, i);
+            e.Load(EAX, in->rs);
+            if (in->opCode == OP_DIV) {
+                e.Bytes(0x83, 0xF9, 0xFF);  // cmp ecx, -1
+                AddExit(e.Jump(CC_E), false, i);
+                e.Byte(0x99);               // cdq
+                e.Bytes(0xF7, 0xF9);        // idiv ecx
+            } else {
+                e.Bytes(0x31, 0xD2);        // xor edx, edx
+                e.Bytes(0xF7, 0xF1);        // div ecx
+            }
+            e.Store(LO_REG, EAX);
+            e.Store(HI_REG, EDX);
+            break;
+
+        case OP_BEQ:
+            e.Load(EAX, in->rs);
+            e.Alu(ALU_CMP, EAX, in->rt);
+            EmitBranch(i, CC_NE);
+            break;
+
+        case OP_BNE:
+            e.Load(EAX, in->rs);
+            e.Alu(ALU_CMP, EAX, in->rt);
+            EmitBranch(i, CC_E);
+            break;
+
+        case OP_BGEZ:
+        case OP_BGEZAL:
+        case OP_BGTZ:
+        case OP_BLEZ:
+        case OP_BLTZ:
+        case OP_BLTZAL: {
+            bool link = in->opCode == OP_BGEZAL || in->opCode == OP_BLTZAL;
+            if (link)
+                e.StoreImm(RET_ADDR_REG, Address(i) + 8);
+            e.Load(EAX, in->rs);
+            e.Bytes(0x85, 0xC0);  // test eax, eax
+            unsigned skip = in->opCode == OP_BGTZ ? CC_LE
+                          : in->opCode == OP_BLEZ ? CC_G
+                          : in->opCode == OP_BLTZ || in->opCode == OP_BLTZAL
+                            ? CC_NS : CC_S;
+            EmitBranch(i, skip);
+            break;
+        }
+
+        case OP_J:
+        case OP_JAL:
+            if (in->opCode == OP_JAL)
+                e.StoreImm(RET_ADDR_REG, Address(i) + 8);
+            e.StoreImm(NEXT_PC_REG, ((Address(i) + 8) & 0xF0000000)
+                                    | IndexToAddr(in->extra));
+            break;
+
+        case OP_JALR:
+        case OP_JR:
+            if (in->opCode == OP_JALR)
+                e.StoreImm(in->rd, Address(i) + 8);
+            e.Load(EAX, in->rs);
+            e.Store(NEXT_PC_REG, EAX);
+            break;
+
+        case OP_LB:
+        case OP_LBU:
+            EmitRead(i, 1);
+            e.Bytes(0x0F, in->opCode == OP_LB ? 0xBE : 0xB6, 0xC0);
+            break;
+
+        case OP_LH:
+        case OP_LHU:
+            EmitRead(i, 2);
+            e.Bytes(0x0F, in->opCode == OP_LH ? 0xBF : 0xB7, 0xC0);
+            break;
+
+        case OP_LW:
+            EmitRead(i, 4);
+            break;
+
+        case OP_SB:
+            EmitWrite(i, 1);
+            break;
+
+        case OP_SH:
+            EmitWrite(i, 2);
+            break;
+
+        case OP_SW:
+            EmitWrite(i, 4);
+            break;
+
+        default:
+            ASSERT(false);
+    }
+}
+
+/// Set the next program counter of a conditional branch.  The flags must
+/// be set already; `skip` is the condition for the branch not to be taken.
+void
+BlockTranslator::EmitBranch(unsigned i, unsigned skip)
+{
+    e.StoreImm(NEXT_PC_REG, Address(i) + 8);
+    e.Bytes(0x70 | skip, 10);  // Jump over the next `StoreImm`.
+    e.StoreImm(NEXT_PC_REG, Address(i) + 4 + IndexToAddr(first[i].extra));
+}
+
+/// Leave the value read in `eax`.
+void
+BlockTranslator::EmitRead(unsigned i, unsigned size)
+{
+    e.Load(EAX, first[i].rs);
+    e.AluImm(EXT_ADD, EAX, first[i].extra);
+    e.Bytes(0x89, 0xC6);                    // mov esi, eax
+    e.Call(readers[size / 2]);
+    e.Bytes(0x48, 0x89, 0xC1);              // mov rcx, rax
+    e.Bytes(0x48, 0xC1, 0xE9); e.Byte(32);  // shr rcx, 32
+    AddExit(e.Jump(CC_NE), false, i);
+}
+
+void
+BlockTranslator::EmitWrite(unsigned i, unsigned size)
+{
+    e.Load(EAX, first[i].rs);
+    e.AluImm(EXT_ADD, EAX, first[i].extra);
+    e.Bytes(0x89, 0xC6);         // mov esi, eax
+    e.Load(EDX, first[i].rt);
+    e.Call(writers[size / 2]);
+    e.Bytes(0x85, 0xC0);         // test eax, eax
+    AddExit(e.Jump(CC_NE), true, i);
+}
+
+void
+BlockTranslator::EmitCompletion(unsigned i)
+{
+    bool pending = i > 0 && IsLoad(i - 1);
+    bool zero    = Destination(i) == 0;
+
+    if (pending) {
+        e.Load(ECX, LOAD_VALUE_REG);
+        e.Store(first[i - 1].rt, ECX);
+        zero = zero || first[i - 1].rt == 0;
+    }
+    if (IsLoad(i)) {
+        e.Store(LOAD_VALUE_REG, EAX);
+        e.StoreImm(LOAD_REG, first[i].rt);
+    } else if (pending) {
+        e.StoreImm(LOAD_VALUE_REG, 0);
+        e.StoreImm(LOAD_REG, 0);
+    }
+    if (zero)
+        e.StoreImm(0, 0);
+}
+
+/// Leave the block right before instruction `i`, which may lie just past
+/// the end of the block.
+void
+BlockTranslator::EmitExitBefore(unsigned i)
+{
+    if (i > 0) {
+        e.StoreImm(PREV_PC_REG, Address(i) - 4);
+        e.StoreImm(PC_REG, Address(i));
+        if (!first[i - 1].IsControlTransfer())
+            e.StoreImm(NEXT_PC_REG, Address(i) + 4);
+    }
+    e.Return(i);
+}
+
+/// Leave the block right after instruction `i`.
+void
+BlockTranslator::EmitExitAfter(unsigned i)
+{
+    if (!branch || i < length - 1) {
+        EmitExitBefore(i + 1);
+        return;
+    }
+
+    // After a delay slot, go to the target of the branch.
+    e.StoreImm(PREV_PC_REG, Address(i));
+    e.Load(EAX, NEXT_PC_REG);
+    e.Store(PC_REG, EAX);
+    e.Bytes(0x83, 0xC0, 0x04);  // add eax, 4
+    e.Store(NEXT_PC_REG, EAX);
+    e.Return(length);
+}
+
+/// A store could not be done (status 1 in `eax`), or it modified the code
+/// of the block (status 2).
+void
+BlockTranslator::EmitExitStore(unsigned i)
+{
+    e.Bytes(0x83, 0xF8, 0x01);  // cmp eax, 1
+    AddExit(e.Jump(CC_E), false, i);
+    EmitCompletion(i);
+    EmitExitAfter(i);
+}
+
+/// Instructions that translated code knows how to execute.
+static bool
+IsTranslatable(const Instruction *in)
+{
+    switch (in->opCode) {
+        case OP_ADD: case OP_ADDI: case OP_ADDIU: case OP_ADDU: case OP_AND:
+        case OP_ANDI: case OP_BEQ: case OP_BGEZ: case OP_BGEZAL:
+        case OP_BGTZ: case OP_BLEZ: case OP_BLTZ: case OP_BLTZAL: case OP_BNE:
+        case OP_DIV: case OP_DIVU: case OP_J: case OP_JAL: case OP_JALR:
+        case OP_JR: case OP_LB: case OP_LBU: case OP_LH: case OP_LHU:
+        case OP_LUI: case OP_LW: case OP_MFHI: case OP_MFLO: case OP_MTHI:
+        case OP_MTLO: case OP_MULT: case OP_MULTU: case OP_NOR: case OP_OR:
+        case OP_ORI: case OP_SB: case OP_SH: case OP_SLL: case OP_SLLV:
+        case OP_SLT: case OP_SLTI: case OP_SLTIU: case OP_SLTU: case OP_SRA:
+        case OP_SRAV: case OP_SRL: case OP_SRLV: case OP_SUB: case OP_SUBU:
+        case OP_SW: case OP_XOR: case OP_XORI:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool
+AccessesData(const Instruction *in)
+{
+    switch (in->opCode) {
+        case OP_LB: case OP_LBU: case OP_LH: case OP_LHU: case OP_LW:
+        case OP_SB: case OP_SH: case OP_SW:
+            return true;
+        default:
+            return false;
+    }
+}
+
+#endif
+
+
+Jit::Jit(MMU *mmu_, int *registers_, bool translate_)
+{
+    ASSERT(mmu_ != nullptr);
+    ASSERT(registers_ != nullptr);
+
+    mmu             = mmu_;
+    registers       = registers_;
+    context.mmu     = mmu;
+    context.module.opaque = &context;
+    if (mmu->GetMode() == TLB_TRANSLATION)
+        SelectAccesses<TLB_TRANSLATION>(readers, writers, &context.module);
+    else
+        SelectAccesses<PAGE_TABLE_TRANSLATION>(readers, writers,
+                                               &context.module);
+    blocks          = new Block [NUM_PHYS_PAGES * WORDS_PER_PAGE];
+    versions        = new unsigned [NUM_PHYS_PAGES];
+    code            = nullptr;
+    codeUsed        = 0;
+    translate       = translate_;
+    module          = nullptr;
+    moduleBlocks    = nullptr;
+    numModuleBlocks = 0;
+    for (unsigned i = 0; i < NUM_PHYS_PAGES; i++)
+        versions[i] = 0;
+    Flush();
+
+#ifdef __x86_64__
+    if (translate) {
+        void *buffer = mmap(nullptr, CODE_SIZE,
+                            PROT_READ | PROT_WRITE | PROT_EXEC,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (buffer != MAP_FAILED)
+            code = (unsigned char *) buffer;
+    }
+#endif
+    DEBUG('m', "Translation of user code %s\n",
+          code != nullptr ? "enabled" : "not available");
+}
+
+Jit::~Jit()
+{
+#ifdef __x86_64__
+    if (code != nullptr)
+        munmap(code, CODE_SIZE);
+#endif
+    if (module != nullptr)
+        dlclose(module);
+    delete [] blocks;
+    delete [] versions;
+}
+
+bool
+Jit::IsEnabled() const
+{
+    return code != nullptr || numModuleBlocks > 0;
+}
+
+bool
+Jit::LoadModule(const char *path)
+{
+    ASSERT(path != nullptr);
+
+    void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (handle == nullptr) {
+        DEBUG('m', "Cannot load module: %s\n", dlerror());
+        return false;
+    }
+
+    const int *version = (const int *) dlsym(handle,
+                                             TRANSLATED_VERSION_SYMBOL);
+    const unsigned *count = (const unsigned *) dlsym(handle,
+                                                     TRANSLATED_COUNT_SYMBOL);
+    const translatedBlock *list = (const translatedBlock *)
+                                  dlsym(handle, TRANSLATED_BLOCKS_SYMBOL);
+    if (version == nullptr || count == nullptr || list == nullptr
+          || *version != TRANSLATED_VERSION) {
+        DEBUG('m', "Module %s does not match this simulator\n", path);
+        dlclose(handle);
+        return false;
+    }
+
+    if (module != nullptr)
+        dlclose(module);
+    module          = handle;
+    moduleBlocks    = list;
+    numModuleBlocks = *count;
+    Flush();
+    DEBUG('m', "Loaded %u translated blocks from %s\n",
+          numModuleBlocks, path);
+    return true;
+}
+
+const translatedBlock *
+Jit::FindPrecompiled(unsigned pc, const Instruction *page,
+                     unsigned offset) const
+{
+    // Find the first block at `pc`.
+    unsigned low = 0, high = numModuleBlocks;
+    while (low < high) {
+        unsigned middle = (low + high) / 2;
+        if (moduleBlocks[middle].pc < pc)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    // Several programs may have code at the same address.
+    for (unsigned k = low; k < numModuleBlocks && moduleBlocks[k].pc == pc;
+         k++) {
+        const translatedBlock *candidate = &moduleBlocks[k];
+        if (candidate->length > WORDS_PER_PAGE - offset)
+            continue;
+        unsigned i = 0;
+        while (i < candidate->length
+               && candidate->words[i] == page[offset + i].value)
+            i++;
+        if (i == candidate->length)
+            return candidate;
+    }
+    return nullptr;
+}
+
+unsigned
+Jit::Run(unsigned pc, unsigned frame, const Instruction *page,
+         unsigned version, unsigned long limit)
+{
+    ASSERT(frame < NUM_PHYS_PAGES);
+    ASSERT(page != nullptr);
+
+    if (!IsEnabled())
+        return 0;
+
+    if (versions[frame] != version) {
+        Forget(frame);
+        versions[frame] = version;
+    }
+
+    unsigned offset = pc % PAGE_SIZE / 4;
+    Block *block = &blocks[frame * WORDS_PER_PAGE + offset];
+    if (block->pc != pc) {
+        // The frame is mapped somewhere else now.
+        block->code        = nullptr;
+        block->count       = 0;
+        block->failed      = false;
+        block->precompiled = nullptr;
+        block->searched    = false;
+        block->pc          = pc;
+    }
+    if (!block->searched) {
+        block->searched    = true;
+        block->precompiled = FindPrecompiled(pc, page, offset);
+    }
+
+    const translatedBlock *precompiled = block->precompiled;
+    if (precompiled == nullptr && block->code == nullptr) {
+        if (!translate || block->failed || ++block->count < HOT_THRESHOLD)
+            return 0;
+        if (code == nullptr || !Translate(block, pc, page, offset)) {
+            block->failed = true;
+            return 0;
+        }
+    }
+
+    unsigned length     = precompiled != nullptr ? precompiled->length
+                                                 : block->length;
+    unsigned dataAccess = precompiled != nullptr ? precompiled->dataAccess
+                                                 : block->dataAccess;
+    if (length > limit)
+        return 0;
+
+    context.frame = frame;
+    unsigned executed = precompiled != nullptr
+                        ? precompiled->code(registers, &context.module)
+                        : block->code(registers, &context);
+    if (executed > 0) {
+        // The instructions after the first one were fetched, too.  The
+        // data accesses already moved the page to the front of the TLB
+        // order, unless the last instruction accessed data itself.
+        bool lastAccessedData = dataAccess >> (executed - 1) & 1;
+        mmu->RepeatFetch(executed - 1, !lastAccessedData);
+    }
+    return executed;
+}
+
+bool
+Jit::Translate(Block *block, unsigned pc, const Instruction *page,
+               unsigned offset)
+{
+#ifdef __x86_64__
+    // Find where the block ends: after the delay slot of a branch, right
+    // before something that cannot be translated, or at the end of the
+    // page.
+    const Instruction *first = &page[offset];
+    unsigned length = 0;
+    bool branch = false;
+    for (unsigned i = offset; i < WORDS_PER_PAGE; i++) {
+        if (!IsTranslatable(&page[i]))
+            break;
+        if (page[i].IsControlTransfer()) {
+            if (i + 1 < WORDS_PER_PAGE && IsTranslatable(&page[i + 1])
+                  && !page[i + 1].IsControlTransfer()) {
+                length += 2;
+                branch = true;
+            }
+            break;
+        }
+        length++;
+    }
+    if (length == 0)
+        return false;
+
+    if (CODE_SIZE - codeUsed < MAX_BLOCK_CODE) {
+        Flush();
+        // `Flush` forgot this block too.  `Run` already looked it up and
+        // searched the module, so keep it tied to `pc`.
+        block->pc       = pc;
+        block->searched = true;
+    }
+
+    BlockTranslator translator(code + codeUsed, pc, first, length, branch,
+                               readers, writers);
+    unsigned char *end = translator.Emit();
+    ASSERT(end - (code + codeUsed) <= (int) MAX_BLOCK_CODE);
+
+    block->code       = (BlockCode) (code + codeUsed);
+    block->length     = length;
+    block->dataAccess = 0;
+    for (unsigned i = 0; i < length; i++)
+        if (AccessesData(&first[i]))
+            block->dataAccess |= 1u << i;
+    codeUsed = end - code;
+
+    DEBUG('m', "Translated %u instructions at 0x%X into %u bytes\n",
+          length, pc, (unsigned) (end - (unsigned char *) block->code));
+    return true;
+#else
+    return false;
+#endif
+}
+
+void
+Jit::Forget(unsigned frame)
+{
+    ASSERT(frame < NUM_PHYS_PAGES);
+
+    Block *block = &blocks[frame * WORDS_PER_PAGE];
+    for (unsigned i = 0; i < WORDS_PER_PAGE; i++) {
+        block[i].code        = nullptr;
+        block[i].pc          = 0;
+        block[i].count       = 0;
+        block[i].failed      = false;
+        block[i].precompiled = nullptr;
+        block[i].searched    = false;
+    }
+}
+
+void
+Jit::Flush()
+{
+    for (unsigned i = 0; i < NUM_PHYS_PAGES; i++)
+        Forget(i);
+    codeUsed = 0;
+}
@@ -0,0 +1,147 @@
+/// Dynamic translation of hot user code into host code.
+///
+/// The JIT counts how many times each basic block of user code is entered
+/// and, once a block gets hot, translates it into x86-64 code that works
+/// directly on `Machine::registers`.  Translated blocks then run without
+/// any fetching or decoding at all.
+///
+/// Blocks are keyed by physical page and offset, like the instruction
+/// cache, and are thrown away whenever their page is decoded again.  Memory
+/// is accessed through `MMU::TryReadMem` and `MMU::TryWriteMem`, specialized
+/// on the translation mode of the MMU and the size of the access: when an
+/// access would fault, the block stops right before the instruction, so
+/// that the interpreter executes it again and raises the exception.  System
+/// calls and the rare instructions the translator does not know about end
+/// blocks as well.
+///
+/// Code can also be translated ahead of time, with `bin/noff2c`, into a
+/// module that is loaded at startup.  Blocks found in a module are run from
+/// their very first entry, whatever the host, and are preferred over the
+/// ones translated here.
+///
+/// On hosts other than x86-64 nothing is ever translated at run time.
+///
+/// Copyright (c) 2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_MACHINE_JIT__HH
+#define NACHOS_MACHINE_JIT__HH
+
+
+#include "instruction.hh"
+#include "mmu.hh"
+#include "translated.h"
+
+
+/// What translated code needs to know, passed to it on every call.
+struct JitContext {
+    MMU *mmu;
+    unsigned frame;  ///< Physical page of the running block.
+
+    /// Memory access for blocks of a module, which refer back to this
+    /// context.
+    translatedContext module;
+};
+
+class Jit {
+public:
+
+    /// Prepare to run translated code on `registers`, with memory accessed
+    /// through `mmu`.  Hot blocks are translated only if `translate` is
+    /// true; otherwise only the blocks of a module are run.
+    Jit(MMU *mmu, int *registers, bool translate = true);
+
+    ~Jit();
+
+    /// Return true if there is any translated code to run.
+    bool IsEnabled() const;
+
+    /// Load the module of blocks translated ahead of time at `path`.
+    ///
+    /// Returns false, leaving any module loaded before, if the file cannot
+    /// be loaded or was generated for some other version of the interface.
+    bool LoadModule(const char *path);
+
+    /// Run the translated block that starts at virtual address `pc`.
+    ///
+    /// * `frame` is the physical page `pc` lives in, and `page` the decoded
+    ///   contents of that page, as returned by the instruction cache.
+    /// * `version` is the instruction cache version of `page`.
+    /// * `limit` is the maximum number of instructions that may be run.
+    ///
+    /// The fetch of the first instruction must already be accounted for in
+    /// the MMU.  There must be no delayed load pending.
+    ///
+    /// Returns how many instructions were executed, which may be 0 if the
+    /// block is not hot yet, cannot be translated, or would run for too
+    /// long.  Blocks of the module run without getting hot first.
+    unsigned Run(unsigned pc, unsigned frame, const Instruction *page,
+                 unsigned version, unsigned long limit);
+
+private:
+
+    /// Translated code for a block.  Returns how many instructions it
+    /// executed.
+    typedef unsigned (*BlockCode)(int *registers, JitContext *context);
+
+    /// What is known about the block starting at some word.
+    struct Block {
+        BlockCode code;       ///< Translated code, if any.
+        unsigned pc;          ///< Virtual address the block was seen at.
+        unsigned length;      ///< Number of instructions.
+        unsigned dataAccess;  ///< Bit `i` is set if instruction `i`
+                              ///< accesses data memory.
+        unsigned count;       ///< Number of times the block was entered.
+        bool failed;          ///< Whether translation was not possible.
+        const translatedBlock *precompiled;  ///< Block of the module, if
+                                             ///< any.
+        bool searched;        ///< Whether the module was searched already.
+    };
+
+    /// Translate the block at word `offset` of `page`, that starts at
+    /// virtual address `pc`.  Returns false if nothing could be translated.
+    bool Translate(Block *block, unsigned pc, const Instruction *page,
+                   unsigned offset);
+
+    /// Return the block of the module that starts at virtual address `pc`
+    /// and matches word `offset` of `page` onwards, or null.
+    const translatedBlock *FindPrecompiled(unsigned pc,
+                                           const Instruction *page,
+                                           unsigned offset) const;
+
+    /// Forget every translated block of physical page `frame`.
+    void Forget(unsigned frame);
+
+    /// Forget every translated block and reuse the code buffer.
+    void Flush();
+
+    MMU *mmu;
+    int *registers;
+    JitContext context;
+
+    /// Memory accesses called by translated code, indexed by `size / 2`.
+    const void *readers[3];
+    const void *writers[3];
+
+    /// One entry per word of physical memory.
+    Block *blocks;
+
+    /// Instruction cache version each page was translated from.
+    unsigned *versions;
+
+    /// Executable memory where translated code is emitted.
+    unsigned char *code;
+    unsigned codeUsed;
+
+    /// Whether hot blocks are translated.
+    bool translate;
+
+    /// Loaded module, and its blocks sorted by address.
+    void *module;
+    const translatedBlock *moduleBlocks;
+    unsigned numModuleBlocks;
+};
+
+
+#endif
@@ -9,8 +9,12 @@
 
 
 #include "machine.hh"
+#include "jit.hh"
+#include "mmu_access.hh"
 #include "threads/system.hh"
 
+#include <string.h>
+
 
 static inline bool
 IsExceptionType(ExceptionType t)
@@ -40,21 +44,63 @@ CheckEndian()
 #endif
 }
 
+static const char *ENGINE_NAMES[] = { "interp", "threaded", "jit" };
+
+ExecutionEngine
+ExecutionEngineFromString(const char *name)
+{
+    ASSERT(name != nullptr);
+
+    unsigned i;
+    for (i = 0; i < NUM_EXECUTION_ENGINES; i++)
+        if (strcmp(name, ENGINE_NAMES[i]) == 0)
+            break;
+    return (ExecutionEngine) i;
+}
+
 /// Initialize the simulation of user program execution.
 ///
 /// * `st` -- pointer to an object that performs single stepping, for
 ///   dropping into it after each user instruction is executed; if null,
 ///   execute normally, without single stepping.
-Machine::Machine(SingleStepper *st)
+/// * `e` -- the execution engine to use for running user code.
+/// * `batch` -- whether to advance simulated time in batches.
+Machine::Machine(SingleStepper *st, ExecutionEngine e, bool batch)
 {
+    ASSERT(e < NUM_EXECUTION_ENGINES);
+
     for (unsigned i = 0; i < NUM_TOTAL_REGS; i++)
         registers[i] = 0;
 
     for (unsigned i = 0; i < NUM_EXCEPTION_TYPES; i++)
         handlers[i] = nullptr;
 
-    singleStepper = st;
+    singleStepper    = st;
+    engine           = e;
+    batchTicks       = batch;
+    unbilled         = 0;
+    exceptionCount   = 0;
+    threadedCode     = nullptr;
+    threadedVersions = nullptr;
+    jit              = e == JIT_ENGINE ? new Jit(&mmu, registers) : nullptr;
     CheckEndian();
+    DEBUG('m', "Using the %s execution engine\n", ENGINE_NAMES[engine]);
+}
+
+Machine::~Machine()
+{
+    FreeThreadedCode();
+    delete jit;
+}
+
+bool
+Machine::LoadTranslatedCode(const char *path)
+{
+    ASSERT(path != nullptr);
+
+    if (jit == nullptr)
+        jit = new Jit(&mmu, registers, false);
+    return jit->LoadModule(path);
 }
 
 const int *
@@ -90,12 +136,53 @@ Machine::WriteRegister(unsigned num, int value)
 
 bool
 Machine::ReadMem(unsigned addr, unsigned size, int *value)
+{
+    if (mmu.GetMode() == TLB_TRANSLATION)
+        return ReadSized<TLB_TRANSLATION>(addr, size, value);
+    return ReadSized<PAGE_TABLE_TRANSLATION>(addr, size, value);
+}
+
+bool
+Machine::WriteMem(unsigned addr, unsigned size, int value)
+{
+    if (mmu.GetMode() == TLB_TRANSLATION)
+        return WriteSized<TLB_TRANSLATION>(addr, size, value);
+    return WriteSized<PAGE_TABLE_TRANSLATION>(addr, size, value);
+}
+
+template <TranslationMode MODE>
+bool
+Machine::ReadSized(unsigned addr, unsigned size, int *value)
+{
+    switch (size) {
+        case 1:  return ReadMem<MODE, 1>(addr, value);
+        case 2:  return ReadMem<MODE, 2>(addr, value);
+        case 4:  return ReadMem<MODE, 4>(addr, value);
+        default: ASSERT(false); return false;
+    }
+}
+
+template <TranslationMode MODE>
+bool
+Machine::WriteSized(unsigned addr, unsigned size, int value)
+{
+    switch (size) {
+        case 1:  return WriteMem<MODE, 1>(addr, value);
+        case 2:  return WriteMem<MODE, 2>(addr, value);
+        case 4:  return WriteMem<MODE, 4>(addr, value);
+        default: ASSERT(false); return false;
+    }
+}
+
+template <TranslationMode MODE, unsigned SIZE>
+bool
+Machine::ReadMem(unsigned addr, int *value)
 {
     // Plancha 4 - Ejercicio 1
     // Try ATTEMPS_NUMBER times to read memory
     for (size_t i = 0; i < ATTEMPTS_NUMBER; i++){
         DEBUG('m', "Leyendo en memoria - intento %d\n", i);
-        ExceptionType e = mmu.ReadMem(addr, size, value);
+        ExceptionType e = mmu.ReadMem<MODE, SIZE>(addr, value);
         if (e == NO_EXCEPTION) {
             return true;
         }
@@ -105,14 +192,15 @@ Machine::ReadMem(unsigned addr, unsigned size, int *value)
     return false;
 }
 
+template <TranslationMode MODE, unsigned SIZE>
 bool
-Machine::WriteMem(unsigned addr, unsigned size, int value)
+Machine::WriteMem(unsigned addr, int value)
 {
     // Plancha 4 - Ejercicio 1
     // Try ATTEMPTS_NUMBER times to write memory
     for (size_t i = 0; i < ATTEMPTS_NUMBER; i++){
         DEBUG('m', "Escribiendo en memoria - intento %d\n", i);
-        ExceptionType e = mmu.WriteMem(addr, size, value);
+        ExceptionType e = mmu.WriteMem<MODE, SIZE>(addr, value);
         if (e == NO_EXCEPTION) {
             return true;
         }
@@ -122,6 +210,84 @@ Machine::WriteMem(unsigned addr, unsigned size, int value)
     return false;
 }
 
+// The engines in `mips_sim.cc` and `threaded_sim.cc` use these.
+template bool Machine::ReadMem<PAGE_TABLE_TRANSLATION, 1>(unsigned, int *);
+template bool Machine::ReadMem<PAGE_TABLE_TRANSLATION, 2>(unsigned, int *);
+template bool Machine::ReadMem<PAGE_TABLE_TRANSLATION, 4>(unsigned, int *);
+template bool Machine::WriteMem<PAGE_TABLE_TRANSLATION, 1>(unsigned, int);
+template bool Machine::WriteMem<PAGE_TABLE_TRANSLATION, 2>(unsigned, int);
+template bool Machine::WriteMem<PAGE_TABLE_TRANSLATION, 4>(unsigned, int);
+template bool Machine::ReadMem<TLB_TRANSLATION, 1>(unsigned, int *);
+template bool Machine::ReadMem<TLB_TRANSLATION, 2>(unsigned, int *);
+template bool Machine::ReadMem<TLB_TRANSLATION, 4>(unsigned, int *);
+template bool Machine::WriteMem<TLB_TRANSLATION, 1>(unsigned, int);
+template bool Machine::WriteMem<TLB_TRANSLATION, 2>(unsigned, int);
+template bool Machine::WriteMem<TLB_TRANSLATION, 4>(unsigned, int);
+
+bool
+Machine::ReadBlock(unsigned addr, char *buffer, unsigned count)
+{
+    unsigned done = 0, attempts = 0;
+    for (;;) {
+        unsigned n;
+        ExceptionType e = mmu.ReadBlock(addr + done, buffer + done,
+                                        count - done, &n);
+        done += n;
+        if (e == NO_EXCEPTION)
+            return true;
+        if (n > 0)
+            attempts = 0;
+        RaiseBlockException(e, addr + done, &attempts);
+    }
+}
+
+bool
+Machine::WriteBlock(unsigned addr, const char *buffer, unsigned count)
+{
+    unsigned done = 0, attempts = 0;
+    for (;;) {
+        unsigned n;
+        ExceptionType e = mmu.WriteBlock(addr + done, buffer + done,
+                                         count - done, &n);
+        done += n;
+        if (e == NO_EXCEPTION)
+            return true;
+        if (n > 0)
+            attempts = 0;
+        RaiseBlockException(e, addr + done, &attempts);
+    }
+}
+
+unsigned
+Machine::StringLength(unsigned addr, unsigned max)
+{
+    unsigned length = 0, attempts = 0;
+    for (;;) {
+        unsigned n;
+        ExceptionType e = mmu.StringLength(addr + length, max - length, &n);
+        length += n;
+        if (e == NO_EXCEPTION)
+            return length;
+        if (n > 0)
+            attempts = 0;
+        RaiseBlockException(e, addr + length, &attempts);
+    }
+}
+
+void
+Machine::RaiseBlockException(ExceptionType e, unsigned addr,
+                             unsigned *attempts)
+{
+    ASSERT(attempts != nullptr);
+
+    // Plancha 4 - Ejercicio 1
+    // As `ReadMem`, give up after ATTEMPTS_NUMBER tries on one page.
+    (*attempts)++;
+    ASSERT(*attempts <= ATTEMPTS_NUMBER);
+    DEBUG('m', "Bloque en memoria - intento %u\n", *attempts);
+    RaiseException(e, addr);
+}
+
 /// Transfer control to the Nachos kernel from user mode, because the user
 /// program either invoked a system call, or some exception occured (such as
 /// the address translation failed).
@@ -136,6 +302,9 @@ Machine::RaiseException(ExceptionType et, unsigned badVAddr)
 
     DEBUG('m', "Exception: %s\n", ExceptionTypeToString(et));
 
+    exceptionCount++;
+    BillInstructions();  // The kernel must see the right time.
+
     //ASSERT(interrupt->GetStatus() == USER_MODE);
     registers[BAD_VADDR_REG] = badVAddr;
     DelayedLoad(0, 0);  // Finish anything in progress.
@@ -51,9 +51,27 @@ enum {
 const unsigned ATTEMPTS_NUMBER = 4;  ///< ReadMem and WriteMem number of attemps in case of Page not Loaded yet.
 
 class Instruction;
+class Jit;
+struct ThreadedSlot;
 
 typedef void (*ExceptionHandler)(ExceptionType);
 
+/// The ways the simulator can execute user code, selectable at startup.
+enum ExecutionEngine {
+    /// Fetch, decode and execute one instruction at a time (`mips_sim.cc`).
+    INTERPRETED_ENGINE,
+    /// Direct-threaded interpretation of basic blocks (`threaded_sim.cc`).
+    THREADED_ENGINE,
+    /// Threaded engine, plus translation of hot blocks to host code
+    /// (`jit.cc`).
+    JIT_ENGINE,
+    NUM_EXECUTION_ENGINES
+};
+
+/// Return the engine named `name`, or `NUM_EXECUTION_ENGINES` if there is
+/// no such engine.
+ExecutionEngine ExecutionEngineFromString(const char *name);
+
 /// The following class defines the simulated host workstation hardware, as
 /// seen by user programs -- the CPU registers, main memory, etc.
 ///
@@ -71,13 +89,23 @@ class Machine {
 public:
 
     /// Initialize the simulation of the hardware for running user programs.
-    Machine(SingleStepper *st);
+    Machine(SingleStepper *st, ExecutionEngine e = INTERPRETED_ENGINE,
+            bool batch = false);
+
+    ~Machine();
 
     /// Routines callable by the Nachos kernel.
 
     /// Run a user program.
     void Run();
 
+    /// Run the blocks of the module at `path`, translated ahead of time by
+    /// `bin/noff2c`, whenever they are found in memory.  This implies the
+    /// threaded engine, if the interpreter was selected.
+    ///
+    /// Return false if the module cannot be loaded.
+    bool LoadTranslatedCode(const char *path);
+
     const int *GetRegisters() const;
 
     MMU *GetMMU();
@@ -95,19 +123,67 @@ public:
 
     bool WriteMem(unsigned addr, unsigned size, int value);
 
+    /// The same, for a translation mode and a size (1, 2, or 4 bytes)
+    /// known at compile time (see `MMU::ReadMem`).
+    template <TranslationMode MODE, unsigned SIZE>
+    bool ReadMem(unsigned addr, int *value);
+
+    template <TranslationMode MODE, unsigned SIZE>
+    bool WriteMem(unsigned addr, int value);
+
+    /// Copy `count` bytes between user memory at `addr` and `buffer`, a
+    /// page at a time.  Exceptions are raised as by `ReadMem`.
+    bool ReadBlock(unsigned addr, char *buffer, unsigned count);
+
+    bool WriteBlock(unsigned addr, const char *buffer, unsigned count);
+
+    /// Return the length of the user string at `addr`, or `max` if it is
+    /// not terminated within `max` bytes.
+    unsigned StringLength(unsigned addr, unsigned max);
+
     /// Print the user CPU and memory state.
     void DumpState();
 
     /// Routines internal to the machine simulation -- DO NOT call these.
+    ///
+    /// Those on `MODE` are specialized on the translation mode of the MMU,
+    /// which `Run` checks once.
+
+    /// Run a user program with the interpreter.  Never returns.
+    template <TranslationMode MODE>
+    void RunInterpreted();
 
     /// Fetch one instruction of a user program.
     ///
     /// Return false if an exception occurs, true otherwise.
+    template <TranslationMode MODE>
     bool FetchInstruction(Instruction *instr);
 
     /// Run a certain instruction of a user program.
+    template <TranslationMode MODE>
     void ExecInstruction(const Instruction *instr);
 
+    /// Fetch and run one instruction, then advance the simulated time.
+    template <TranslationMode MODE>
+    void OneInstruction(Instruction *instr);
+
+    /// Fetch and run up to `count` instructions, during which no interrupt
+    /// can be due, and advance the simulated time for all of them at once.
+    /// Stops early if an exception is raised.
+    template <TranslationMode MODE>
+    void RunBatch(Instruction *instr, unsigned long count);
+
+    /// Advance the simulated time for the instructions run in a batch so
+    /// far.
+    void BillInstructions();
+
+    /// Run a user program with the threaded engine.  Never returns.
+    template <TranslationMode MODE>
+    void RunThreaded();
+
+    /// Release the threaded code built by `RunThreaded`, if any.
+    void FreeThreadedCode();
+
     /// Do a pending delayed load (modifying a reg).
     void DelayedLoad(unsigned nextReg, int nextVal);
 
@@ -134,7 +210,46 @@ private:
 
     MMU mmu; ///< Memory management unit.
 
+    /// `ReadMem` and `WriteMem` for a size only known at run time.
+    template <TranslationMode MODE>
+    bool ReadSized(unsigned addr, unsigned size, int *value);
+
+    template <TranslationMode MODE>
+    bool WriteSized(unsigned addr, unsigned size, int value);
+
+    /// Raise exception `e`, met by a block operation at `addr`, so that
+    /// the operation can go on.  `*attempts` counts the exceptions raised
+    /// since the operation last made progress; too many are fatal.
+    void RaiseBlockException(ExceptionType e, unsigned addr,
+                             unsigned *attempts);
+
     ExceptionHandler handlers[NUM_EXCEPTION_TYPES];  ///< Exception handlers.
+
+    ExecutionEngine engine;  ///< How to run user code.
+
+    /// Whether simulated time is advanced in batches, up to the next
+    /// pending interrupt, rather than after every instruction.
+    bool batchTicks;
+
+    /// Instructions run in the current batch that simulated time was not
+    /// advanced for yet.  Always 0 outside of a batch, and whenever the
+    /// kernel is entered.
+    unsigned long unbilled;
+
+    /// Number of exceptions raised so far.  Engines that keep state derived
+    /// from the current translation use it to notice that the kernel was
+    /// entered (and may have changed the mappings).
+    unsigned exceptionCount;
+
+    /// Threaded code of the threaded engine, `PAGE_SIZE / 4` slots per
+    /// physical page, and the instruction cache version each page was
+    /// built from.
+    ThreadedSlot *threadedCode;
+    unsigned *threadedVersions;
+
+    /// Translator of hot code, for the JIT engine, and runner of code
+    /// translated ahead of time.
+    Jit *jit;
 };
 
 
@@ -13,6 +13,7 @@
 
 #include "instruction.hh"
 #include "machine.hh"
+#include "mmu_access.hh"
 #include "threads/system.hh"
 
 #include <stdio.h>
@@ -27,19 +28,93 @@
 void
 Machine::Run()
 {
-    Instruction *instr = new Instruction;
-      // Storage for decoded instruction.
-
     if (debug.IsEnabled('m'))
         printf("Starting to run at time %lu\n", stats->totalTicks);
     interrupt->SetStatus(USER_MODE);
 
+    // Select the code for the translation mode once: every access made
+    // from here on is specialized for it.
+    bool threaded = engine != INTERPRETED_ENGINE || jit != nullptr;
+    if (mmu.GetMode() == TLB_TRANSLATION) {
+        if (threaded)
+            RunThreaded<TLB_TRANSLATION>();
+        RunInterpreted<TLB_TRANSLATION>();
+    } else {
+        if (threaded)
+            RunThreaded<PAGE_TABLE_TRANSLATION>();
+        RunInterpreted<PAGE_TABLE_TRANSLATION>();
+    }
+}
+
+template <TranslationMode MODE>
+void
+Machine::RunInterpreted()
+{
+    Instruction *instr = new Instruction;
+      // Storage for decoded instruction.
+
     for (;;) {
-        if (FetchInstruction(instr))
-            ExecInstruction(instr);
-        interrupt->OneTick();
-        if (singleStepper != nullptr && !singleStepper->Step())
-            singleStepper = nullptr;
+        unsigned long horizon = batchTicks && singleStepper == nullptr
+                                ? interrupt->InstructionsBeforeDue() : 0;
+        if (horizon > 0)
+            RunBatch<MODE>(instr, horizon);
+        else
+            OneInstruction<MODE>(instr);
+    }
+}
+
+/// Execute a single instruction, advance the clock and drop into the
+/// single stepper, if any.
+///
+/// * `instr` is storage for the decoded instruction.
+template <TranslationMode MODE>
+void
+Machine::OneInstruction(Instruction *instr)
+{
+    ASSERT(instr != nullptr);
+
+    if (FetchInstruction<MODE>(instr))
+        ExecInstruction<MODE>(instr);
+    interrupt->OneTick();
+    if (singleStepper != nullptr && !singleStepper->Step())
+        singleStepper = nullptr;
+}
+
+/// Execute instructions while no interrupt can be due, only counting them;
+/// simulated time is advanced when the batch ends, or before entering the
+/// kernel.
+///
+/// * `instr` is storage for the decoded instruction.
+/// * `count` is the maximum number of instructions to run, as given by
+///   `Interrupt::InstructionsBeforeDue`.
+template <TranslationMode MODE>
+void
+Machine::RunBatch(Instruction *instr, unsigned long count)
+{
+    ASSERT(instr != nullptr);
+    ASSERT(unbilled == 0);
+
+    unsigned exceptions = exceptionCount;
+    for (unsigned long i = 0; i < count; i++) {
+        if (FetchInstruction<MODE>(instr))
+            ExecInstruction<MODE>(instr);
+        if (exceptionCount != exceptions) {
+            // The instructions before this one were accounted for when
+            // the kernel was entered.  Anything may have happened since.
+            interrupt->OneTick();
+            return;
+        }
+        unbilled++;
+    }
+    BillInstructions();
+}
+
+void
+Machine::BillInstructions()
+{
+    if (unbilled > 0) {
+        interrupt->AdvanceInstructions(unbilled);
+        unbilled = 0;
     }
 }
 
@@ -56,16 +131,25 @@ Machine::DelayedLoad(unsigned nextReg, int nextValue)
     registers[0] = 0;  // And always make sure R0 stays zero.
 }
 
+template <TranslationMode MODE>
 bool
 Machine::FetchInstruction(Instruction *instr)
 {
     ASSERT(instr != nullptr);
 
-    int raw;
-    if (!ReadMem(registers[PC_REG], 4, &raw))
-        return false;  // Exception occurred.
-    instr->value = raw;
-    instr->Decode();
+    // Instructions come already decoded from the MMU's instruction cache;
+    // retry as `ReadMem` does in case the page is not loaded yet.
+    const Instruction *decoded = nullptr;
+    for (unsigned i = 0; decoded == nullptr; i++) {
+        ASSERT(i < ATTEMPTS_NUMBER);
+        ExceptionType e = mmu.ReadInstruction<MODE>(registers[PC_REG],
+                                                     &decoded);
+        if (e != NO_EXCEPTION) {
+            RaiseException(e, registers[PC_REG]);
+            decoded = nullptr;
+        }
+    }
+    *instr = *decoded;
 
     if (debug.IsEnabled('m')) {
         const struct OpString *str = &OP_STRINGS[instr->opCode];
@@ -163,6 +247,7 @@ Mult(int a, int b, bool signedArith, int *hiPtr, int *loPtr)
 /// all data back to the machine registers and memory before leaving.  This
 /// allows the Nachos kernel to control our behavior by controlling the
 /// contents of memory, the translation table, and the register set.
+template <TranslationMode MODE>
 void
 Machine::ExecInstruction(const Instruction *instr)
 {
@@ -293,7 +378,7 @@ Machine::ExecInstruction(const Instruction *instr)
         case OP_LB:
         case OP_LBU:
             tmp = registers[instr->rs] + instr->extra;
-            if (!ReadMem(tmp, 1, &value))
+            if (!ReadMem<MODE, 1>(tmp, &value))
                 return;
 
             if (value & 0x80 && instr->opCode == OP_LB)
@@ -311,7 +396,7 @@ Machine::ExecInstruction(const Instruction *instr)
                 RaiseException(ADDRESS_ERROR_EXCEPTION, tmp);
                 return;
             }
-            if (!ReadMem(tmp, 2, &value))
+            if (!ReadMem<MODE, 2>(tmp, &value))
                 return;
 
             if (value & 0x8000 && instr->opCode == OP_LH)
@@ -333,7 +418,7 @@ Machine::ExecInstruction(const Instruction *instr)
                 RaiseException(ADDRESS_ERROR_EXCEPTION, tmp);
                 return;
             }
-            if (!ReadMem(tmp, 4, &value))
+            if (!ReadMem<MODE, 4>(tmp, &value))
                 return;
             nextLoadReg = instr->rt;
             nextLoadValue = value;
@@ -347,7 +432,7 @@ Machine::ExecInstruction(const Instruction *instr)
             // would fail (I think) if the other cases are ever exercised.
             ASSERT((tmp & 0x3) == 0);
 
-            if (!ReadMem(tmp, 4, &value))
+            if (!ReadMem<MODE, 4>(tmp, &value))
                 return;
             if (registers[LOAD_REG] == instr->rt)
                 nextLoadValue = registers[LOAD_VALUE_REG];
@@ -378,7 +463,7 @@ Machine::ExecInstruction(const Instruction *instr)
             // would fail (I think) if the other cases are ever exercised.
             ASSERT((tmp & 0x3) == 0);
 
-            if (!ReadMem(tmp, 4, &value))
+            if (!ReadMem<MODE, 4>(tmp, &value))
                 return;
             if (registers[LOAD_REG] == instr->rt)
                 nextLoadValue = registers[LOAD_VALUE_REG];
@@ -446,14 +531,16 @@ Machine::ExecInstruction(const Instruction *instr)
             break;
 
         case OP_SB:
-            if (!WriteMem((unsigned) (registers[instr->rs] + instr->extra),
-                          1, registers[instr->rt]))
+            if (!WriteMem<MODE, 1>((unsigned) (registers[instr->rs]
+                                                 + instr->extra),
+                                   registers[instr->rt]))
                 return;
             break;
 
         case OP_SH:
-            if (!WriteMem((unsigned) (registers[instr->rs] + instr->extra),
-                          2, registers[instr->rt]))
+            if (!WriteMem<MODE, 2>((unsigned) (registers[instr->rs]
+                                                 + instr->extra),
+                                   registers[instr->rt]))
                 return;
             break;
 
@@ -535,8 +622,9 @@ Machine::ExecInstruction(const Instruction *instr)
             break;
 
         case OP_SW:
-            if (!WriteMem((unsigned) (registers[instr->rs] + instr->extra),
-                          4, registers[instr->rt]))
+            if (!WriteMem<MODE, 4>((unsigned) (registers[instr->rs]
+                                                 + instr->extra),
+                                   registers[instr->rt]))
                 return;
             break;
 
@@ -547,7 +635,7 @@ Machine::ExecInstruction(const Instruction *instr)
             // the other cases are ever exercised.
             ASSERT((tmp & 0x3) == 0);
 
-            if (!ReadMem(tmp & ~0x3, 4, &value))
+            if (!ReadMem<MODE, 4>(tmp & ~0x3, &value))
                 return;
             switch (tmp & 0x3) {
                 case 0:
@@ -566,7 +654,7 @@ Machine::ExecInstruction(const Instruction *instr)
                             | (registers[instr->rt] >> 24 & 0xFF);
                     break;
             }
-            if (!WriteMem(tmp & ~0x3, 4, value))
+            if (!WriteMem<MODE, 4>(tmp & ~0x3, value))
                 return;
             break;
 
@@ -577,7 +665,7 @@ Machine::ExecInstruction(const Instruction *instr)
             // the other cases are ever exercised.
             ASSERT((tmp & 0x3) == 0);
 
-            if (!ReadMem(tmp & ~0x3, 4, &value))
+            if (!ReadMem<MODE, 4>(tmp & ~0x3, &value))
                 return;
             switch (tmp & 0x3) {
                 case 0:
@@ -595,7 +683,7 @@ Machine::ExecInstruction(const Instruction *instr)
                     value = registers[instr->rt];
                     break;
             }
-            if (!WriteMem(tmp & ~0x3, 4, value))
+            if (!WriteMem<MODE, 4>(tmp & ~0x3, value))
                 return;
             break;
 
@@ -633,3 +721,13 @@ Machine::ExecInstruction(const Instruction *instr)
     registers[PC_REG] = registers[NEXT_PC_REG];
     registers[NEXT_PC_REG] = pcAfter;
 }
+
+// The threaded engine (`threaded_sim.cc`) falls back on these.
+template void
+Machine::OneInstruction<PAGE_TABLE_TRANSLATION>(Instruction *);
+template void
+Machine::OneInstruction<TLB_TRANSLATION>(Instruction *);
+template void
+Machine::ExecInstruction<PAGE_TABLE_TRANSLATION>(const Instruction *);
+template void
+Machine::ExecInstruction<TLB_TRANSLATION>(const Instruction *);
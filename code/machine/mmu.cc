@@ -29,36 +29,123 @@
 
 
 #include "mmu.hh"
+#include "mmu_access.hh"
 #include "endianness.hh"
 // Plancha 4 - Ejercicio 1
 #include "threads/system.hh"
 
+#include <string.h>
+
 
 MMU::MMU()
+  : instructionCache(NUM_PHYS_PAGES, PAGE_SIZE)
 {
-    mainMemory = new char [MEMORY_SIZE];
+    mainMemory  = new char [MEMORY_SIZE];
+    currentAsid = 0;
+    for (unsigned i = 0; i < NUM_ASIDS; i++)
+        SetAsidTable(i, nullptr);
+    lastTlbHit  = -1;
+    fetchTlbHit = -1;
+    hardwareRefill  = false;
+    refillTable     = nullptr;
+    superpageShift  = 0;
     for (unsigned i = 0; i < MEMORY_SIZE; i++)
           mainMemory[i] = 0;
 
-#ifdef USE_TLB
-    tlb = new TranslationEntry[TLB_SIZE];
-    tlbStack = new List <int>;
-    for (unsigned i = 0; i < TLB_SIZE; i++)
-        tlb[i].valid = false;
-    pageTable = nullptr;
-#else  // Use linear page table.
-    tlb = nullptr;
+    tlb       = nullptr;
+    tlbSize   = 0;
+    tlbState  = nullptr;
+    tlbHands  = nullptr;
+    tlbHash   = nullptr;
     pageTable = nullptr;
-#endif
+    mode      = DEFAULT_TRANSLATION;
+    if (mode == TLB_TRANSLATION)
+        ConfigureTlb(TLB_SIZE, TLB_SIZE, LRU_TLB_POLICY);
+    // Otherwise, use linear page table.
+    FlushSoftTlb();
 }
 
 MMU::~MMU()
 {
     delete [] mainMemory;
-    if (tlb != nullptr){
-        delete [] tlb;
-        delete tlbStack;
+    delete [] tlb;
+    delete [] tlbState;
+    delete [] tlbHands;
+    delete [] tlbHash;
+}
+
+TranslationMode
+MMU::GetMode() const
+{
+    return mode;
+}
+
+static const char *const TLB_POLICY_NAMES[] = {
+    "lru", "clock", "fifo", "random"
+};
+
+TlbPolicy
+TlbPolicyFromString(const char *name)
+{
+    ASSERT(name != nullptr);
+
+    unsigned i;
+    for (i = 0; i < NUM_TLB_POLICIES; i++)
+        if (strcmp(name, TLB_POLICY_NAMES[i]) == 0)
+            break;
+    return (TlbPolicy) i;
+}
+
+/// Set up a TLB of `size` entries in sets of `ways`, replaced according to
+/// `policy`.
+///
+/// Every entry starts out invalid.  Fully associative TLBs are looked up
+/// through a hash of their entries; the others only search one set.
+void
+MMU::ConfigureTlb(unsigned size, unsigned ways, TlbPolicy policy)
+{
+    ASSERT(size > 0);
+    ASSERT(ways > 0 && ways <= size && size % ways == 0);
+    ASSERT(policy < NUM_TLB_POLICIES);
+
+    delete [] tlb;
+    delete [] tlbState;
+    delete [] tlbHands;
+    delete [] tlbHash;
+
+    tlbSize   = size;
+    tlbWays   = ways;
+    tlbSets   = size / ways;
+    tlbPolicy = policy;
+    tlb       = new TranslationEntry[tlbSize];
+    tlbState  = new TlbEntryState[tlbSize];
+    for (unsigned i = 0; i < tlbSize; i++) {
+        tlb[i].valid           = false;
+        tlb[i].pageShift       = 0;
+        tlbState[i].lastUse    = 0;
+        tlbState[i].loaded     = 0;
+        tlbState[i].referenced = false;
     }
+    tlbHands = new unsigned[tlbSets];
+    for (unsigned i = 0; i < tlbSets; i++)
+        tlbHands[i] = 0;
+    tlbTime   = 0;
+    tlbRandom = 1;
+
+    // Twice as many slots as entries, rounded up to a power of two.
+    tlbHash = nullptr;
+    if (tlbSets == 1) {
+        for (tlbHashSize = 1; tlbHashSize < 2 * tlbSize; tlbHashSize *= 2)
+            ;
+        tlbHash = new int[tlbHashSize];
+    }
+    tlbHashStale = true;
+    lastTlbHit   = -1;
+    fetchTlbHit  = -1;
+    FlushSoftTlb();
+
+    DEBUG('a', "TLB of %u entries, %u ways, %s replacement\n",
+          tlbSize, tlbWays, TLB_POLICY_NAMES[tlbPolicy]);
 }
 
 /// Read `size` (1, 2, or 4) bytes of virtual memory at `addr` into
@@ -73,38 +160,9 @@ MMU::~MMU()
 ExceptionType
 MMU::ReadMem(unsigned addr, unsigned size, int *value)
 {
-    ASSERT(value != nullptr);
-
-    DEBUG('a', "Reading VA 0x%X, size %u\n", addr, size);
-
-    unsigned physicalAddress;
-    ExceptionType e = Translate(addr, &physicalAddress, size, false);
-    if (e != NO_EXCEPTION)
-        return e;
-
-    int data;
-    switch (size) {
-        case 1:
-            data = mainMemory[physicalAddress];
-            *value = data;
-            break;
-
-        case 2:
-            data = *(unsigned short *) &mainMemory[physicalAddress];
-            *value = ShortToHost(data);
-            break;
-
-        case 4:
-            data = *(unsigned *) &mainMemory[physicalAddress];
-            *value = WordToHost(data);
-            break;
-
-        default:
-            ASSERT(false);
-    }
-
-    DEBUG('a', "\tValue read: %8.8X\n", *value);
-    return NO_EXCEPTION;
+    if (mode == TLB_TRANSLATION)
+        return ReadSized<TLB_TRANSLATION>(addr, size, value);
+    return ReadSized<PAGE_TABLE_TRANSLATION>(addr, size, value);
 }
 
 /// Write `size` (1, 2, or 4) bytes of the contents of `value` into virtual
@@ -119,164 +177,443 @@ MMU::ReadMem(unsigned addr, unsigned size, int *value)
 ExceptionType
 MMU::WriteMem(unsigned addr, unsigned size, int value)
 {
-    DEBUG('a', "Writing VA 0x%X, size %u, value 0x%X\n", addr, size, value);
-
-    unsigned physicalAddress;
-    ExceptionType e = Translate(addr, &physicalAddress, size, true);
-    if (e != NO_EXCEPTION)
-        return e;
+    if (mode == TLB_TRANSLATION)
+        return WriteSized<TLB_TRANSLATION>(addr, size, value);
+    return WriteSized<PAGE_TABLE_TRANSLATION>(addr, size, value);
+}
 
+template <TranslationMode MODE>
+ExceptionType
+MMU::ReadSized(unsigned addr, unsigned size, int *value)
+{
     switch (size) {
-        case 1:
-            mainMemory[physicalAddress]
-              = (unsigned char) (value & 0xFF);
-            break;
+        case 1:  return ReadMem<MODE, 1>(addr, value);
+        case 2:  return ReadMem<MODE, 2>(addr, value);
+        case 4:  return ReadMem<MODE, 4>(addr, value);
+        default: ASSERT(false); return ADDRESS_ERROR_EXCEPTION;
+    }
+}
 
-        case 2:
-            *(unsigned short *) &mainMemory[physicalAddress]
-              = ShortToMachine((unsigned short) (value & 0xFFFF));
-            break;
+template <TranslationMode MODE>
+ExceptionType
+MMU::WriteSized(unsigned addr, unsigned size, int value)
+{
+    switch (size) {
+        case 1:  return WriteMem<MODE, 1>(addr, value);
+        case 2:  return WriteMem<MODE, 2>(addr, value);
+        case 4:  return WriteMem<MODE, 4>(addr, value);
+        default: ASSERT(false); return ADDRESS_ERROR_EXCEPTION;
+    }
+}
 
-        case 4:
-            *(unsigned *) &mainMemory[physicalAddress]
-              = WordToMachine((unsigned) value);
-            break;
+/// Copy `count` bytes from virtual address `addr` into `buffer`.
+///
+/// Each page is translated once, as a one byte access, and the part of it
+/// that is needed is copied at once.
+ExceptionType
+MMU::ReadBlock(unsigned addr, char *buffer, unsigned count, unsigned *done)
+{
+    ASSERT(buffer != nullptr);
+    ASSERT(done != nullptr);
+
+    DEBUG('a', "Reading %u bytes at VA 0x%X\n", count, addr);
+
+    *done = 0;
+    while (*done < count) {
+        unsigned physicalAddress;
+        ExceptionType e = TranslateByte<false>(addr + *done,
+                                               &physicalAddress);
+        if (e != NO_EXCEPTION)
+            return e;
+
+        unsigned run = _min(PAGE_SIZE - physicalAddress % PAGE_SIZE,
+                            count - *done);
+        memcpy(buffer + *done, &mainMemory[physicalAddress], run);
+        *done += run;
+    }
+    return NO_EXCEPTION;
+}
 
-        default:
-            ASSERT(false);
+/// Copy `count` bytes from `buffer` to virtual address `addr`.
+ExceptionType
+MMU::WriteBlock(unsigned addr, const char *buffer, unsigned count,
+                unsigned *done)
+{
+    ASSERT(buffer != nullptr);
+    ASSERT(done != nullptr);
+
+    DEBUG('a', "Writing %u bytes at VA 0x%X\n", count, addr);
+
+    *done = 0;
+    while (*done < count) {
+        unsigned physicalAddress;
+        ExceptionType e = TranslateByte<true>(addr + *done,
+                                              &physicalAddress);
+        if (e != NO_EXCEPTION)
+            return e;
+
+        unsigned run = _min(PAGE_SIZE - physicalAddress % PAGE_SIZE,
+                            count - *done);
+        memcpy(&mainMemory[physicalAddress], buffer + *done, run);
+        *done += run;
+
+        unsigned frame = physicalAddress / PAGE_SIZE;
+        if (instructionCache.IsCached(frame))
+            instructionCache.Invalidate(frame);
     }
+    return NO_EXCEPTION;
+}
 
+ExceptionType
+MMU::StringLength(unsigned addr, unsigned max, unsigned *length)
+{
+    ASSERT(length != nullptr);
+
+    *length = 0;
+    while (*length < max) {
+        unsigned physicalAddress;
+        ExceptionType e = TranslateByte<false>(addr + *length,
+                                               &physicalAddress);
+        if (e != NO_EXCEPTION)
+            return e;
+
+        unsigned run = _min(PAGE_SIZE - physicalAddress % PAGE_SIZE,
+                            max - *length);
+        const char *start = &mainMemory[physicalAddress];
+        const char *end = (const char *) memchr(start, '\0', run);
+        if (end != nullptr) {
+            *length += end - start;
+            return NO_EXCEPTION;
+        }
+        *length += run;
+    }
     return NO_EXCEPTION;
 }
 
+template <bool WRITING>
 ExceptionType
-MMU::RetrievePageEntry(unsigned vpn, TranslationEntry **entry) const
+MMU::TranslateByte(unsigned addr, unsigned *physAddr)
 {
-    ASSERT(entry != nullptr);
+    if (mode == TLB_TRANSLATION)
+        return Translate<TLB_TRANSLATION, 1, WRITING, false>(addr, physAddr);
+    return Translate<PAGE_TABLE_TRANSLATION, 1, WRITING, false>(addr,
+                                                                 physAddr);
+}
 
-    if (tlb == nullptr) {
-        // Use a page table; `vpn` is an index in the table.
-
-        if (vpn >= pageTableSize) {
-            DEBUG_CONT('a', "virtual page # %u too large for"
-                            " page table size %u!\n",
-                       vpn, pageTableSize);
-            return ADDRESS_ERROR_EXCEPTION;
-        } else if (!pageTable[vpn].valid) {
-            DEBUG_CONT('a', "virtual page # %u too large for"
-                            " page table size %u!\n",
-                       vpn, pageTableSize);
-            return PAGE_FAULT_EXCEPTION;
-        }
+void
+MMU::RepeatFetch(unsigned count, bool touch)
+{
+    if (tlb == nullptr)
+        return;  // Page table entries only keep the `use` bit, already set.
 
-        *entry = &pageTable[vpn];
-        return NO_EXCEPTION;
-
-    } else {
-        // Use the TLB.
-        // Plancha 4 - Ejercicio 1
-        unsigned i;
-        DEBUG('a', "Buscando VPN: '%d'\n", vpn);
-        for (i = 0; i < TLB_SIZE; i++){
-            if (tlb[i].inMemory && tlb[i].valid && tlb[i].virtualPage == vpn) {
-                DEBUG('a', "Page '%d' found with physical page %d\n", vpn, tlb[i].physicalPage);
-                *entry = &tlb[i];  // FOUND!
-                stats -> numPageFounds++;
-                tlbStack -> Remove(i);
-                tlbStack -> Append(i);
-                return NO_EXCEPTION;
-            }
-        }
+    ASSERT(fetchTlbHit != -1);
+
+    stats->numPageFounds += count;
+    if (touch && lastTlbHit != fetchTlbHit) {
+        TouchTlbEntry(fetchTlbHit);
+        lastTlbHit = fetchTlbHit;
+    }
+}
 
-        // Not found.
-        DEBUG('a', "no valid TLB entry found for this virtual page!\n");
+const InstructionCache *
+MMU::GetInstructionCache() const
+{
+    return &instructionCache;
+}
+
+void
+MMU::InvalidateFrame(unsigned frame)
+{
+    ASSERT(frame < NUM_PHYS_PAGES);
+
+    instructionCache.Invalidate(frame);
+}
+
+void
+MMU::FlushSoftTlb()
+{
+    for (unsigned i = 0; i < SOFT_TLB_SIZE; i++)
+        softTlb[i].valid = false;
+    tlbHashStale = true;  // The TLB itself may have changed too.
+}
+
+void
+MMU::FillSoftTlb(unsigned vpn, TranslationEntry *entry, bool writable)
+{
+    ASSERT(entry != nullptr);
+
+    // Keep traces complete: remembered translations are not traced.
+    if (debug.IsEnabled('a'))
+        return;
+
+    SoftTlbEntry *cached = &softTlb[vpn % SOFT_TLB_SIZE];
+    cached->valid    = true;
+    cached->space    = pageTable;
+    cached->asid     = currentAsid;
+    cached->vpn      = vpn;
+    cached->base     = (entry->physicalPage + vpn - entry->virtualPage)
+                       * PAGE_SIZE;
+    cached->writable = writable;
+    cached->tlbIndex = tlb != nullptr ? entry - tlb : -1;
+}
+
+/// Keep the TLB statistics and the order of its entries by last use.
+///
+/// * `entry` is the entry that was hit, or null on a miss.
+void
+MMU::RecordTlbAccess(const TranslationEntry *entry)
+{
+    if (entry == nullptr) {
         // Plancha 4 - Ejercicio 2
         stats -> numPageFaults++;
         // The next access will be always successful
         stats -> numPageFounds--;
-        return PAGE_FAULT_EXCEPTION;  // Really, this is a TLB fault, the
-                                      // page may be in memory, but not in
-                                      // the TLB.
+        return;
     }
+
+    int i = entry - tlb;
+    stats -> numPageFounds++;
+    TouchTlbEntry(i);
+    lastTlbHit = i;
 }
 
-/// Translate a virtual address into a physical address, using
-/// either a page table or a TLB.
-///
-/// Check for alignment and all sorts of other errors, and if everything is
-/// ok, set the use/dirty bits in the translation table entry, and store the
-/// translated physical address in "physAddr".  If there was an error,
-/// returns the type of the exception.
-///
-/// * `virtAddr" is the virtual address to translate.
-/// * `physAddr" is the place to store the physical address.
-/// * `size" is the amount of memory being read or written.
-/// * `writing` -- if true, check the “read-only” bit in the TLB.
-ExceptionType
-MMU::Translate(unsigned virtAddr, unsigned *physAddr,
-               unsigned size, bool writing)
+TranslationEntry *
+MMU::RefillTlb(unsigned vpn, bool writing, bool probing)
 {
-    ASSERT(physAddr != nullptr);
-    // We must have either a TLB or a page table, but not both!
-    ASSERT((tlb == nullptr) != (pageTable == nullptr));
+    if (!hardwareRefill || refillTable == nullptr
+          || vpn >= refillTable->GetSize())
+        return nullptr;
+
+    TranslationEntry *pte = refillTable->Find(vpn);
+    if (pte == nullptr || !pte->valid || !pte->inMemory)
+        return nullptr;  // A real page fault.
+    if (probing && ((pte->readOnly && writing)
+                    || pte->physicalPage >= NUM_PHYS_PAGES))
+        return nullptr;
+
+    TranslationEntry mapping = refillTable->Mapping(vpn);
+    int victim = getTLBVictimPage(mapping.virtualPage, mapping.pageShift);
+      // Writes the old entry back.
+    TranslationEntry *old = &tlb[victim];
+    pte->inTLB = true;
+    *old = mapping;
+    old->asid = currentAsid;
+    stats->numTlbRefills++;
+    FlushSoftTlb();  // The replaced entry may be remembered there.
+    DEBUG('a', "TLB refill: page %u into entry %d, shift %u\n",
+          vpn, victim, mapping.pageShift);
+    return old;
+}
 
-    DEBUG('a', "\tTranslate: ");
+/// Look `vpn` up in the TLB: in the hash of entries if the TLB is fully
+/// associative, or in the only set the page can be in.
+int
+MMU::FindTlbEntry(unsigned vpn)
+{
+    int i = FindTlbEntry(vpn, 0);
+    if (i == -1 && superpageShift > 0)
+        i = FindTlbEntry(vpn, superpageShift);
+    return i;
+}
 
-    // Check for alignment errors.
-    if ((size == 4 && virtAddr & 0x3) || (size == 2 && virtAddr & 0x1)) {
-        DEBUG_CONT('a', "alignment problem at %u, size %u!\n",
-                   virtAddr, size);
-        return ADDRESS_ERROR_EXCEPTION;
+int
+MMU::FindTlbEntry(unsigned vpn, unsigned shift)
+{
+    unsigned base = vpn >> shift << shift;
+
+    if (tlbHash != nullptr) {
+        if (tlbHashStale)
+            HashTlb();
+        for (unsigned h = base & (tlbHashSize - 1); tlbHash[h] != -1;
+             h = (h + 1) & (tlbHashSize - 1)) {
+            const TranslationEntry *e = &tlb[tlbHash[h]];
+            if (e->inMemory && e->valid && e->virtualPage == base
+                  && e->pageShift >= shift && e->asid == currentAsid)
+                return tlbHash[h];
+        }
+        return -1;
     }
 
-    // Calculate the virtual page number, and offset within the page,
-    // from the virtual address.
-    unsigned vpn    = (unsigned) virtAddr / PAGE_SIZE;
-    unsigned offset = (unsigned) virtAddr % PAGE_SIZE;
+    unsigned first = (vpn >> shift) % tlbSets * tlbWays;
+    for (unsigned i = first; i < first + tlbWays; i++)
+        if (tlb[i].inMemory && tlb[i].valid && tlb[i].virtualPage == base
+              && tlb[i].pageShift >= shift && tlb[i].asid == currentAsid)
+            return i;
+    return -1;
+}
 
-    TranslationEntry *entry;
-    ExceptionType exception = RetrievePageEntry(vpn, &entry);
-    if (exception != NO_EXCEPTION)
-        return exception;
+void
+MMU::HashTlb()
+{
+    ASSERT(tlbHash != nullptr);
+
+    for (unsigned h = 0; h < tlbHashSize; h++)
+        tlbHash[h] = -1;
+    for (unsigned i = 0; i < tlbSize; i++) {
+        if (!tlb[i].valid)
+            continue;
+        unsigned h = tlb[i].virtualPage & (tlbHashSize - 1);
+        while (tlbHash[h] != -1)
+            h = (h + 1) & (tlbHashSize - 1);
+        tlbHash[h] = i;
+    }
+    tlbHashStale = false;
+}
+
+void
+MMU::TouchTlbEntry(int i)
+{
+    ASSERT(i >= 0 && (unsigned) i < tlbSize);
+
+    tlbState[i].lastUse    = ++tlbTime;
+    tlbState[i].referenced = true;
+}
 
-    if (entry->readOnly && writing) {  // Trying to write to a read-only
-                                       // page.
-        DEBUG_CONT('a', "%u mapped read-only!\n", virtAddr);
-        return READ_ONLY_EXCEPTION;
+// Plancha 4 - Ejercicio 5
+// Get the TLB index to replace, in the set of `vpn`
+int
+MMU::getTLBVictimPage(unsigned vpn, unsigned shift)
+{
+    ASSERT(tlb != nullptr);
+
+    unsigned set   = (vpn >> shift) % tlbSets;
+    unsigned first = set * tlbWays;
+    int victim = -1;
+    for (unsigned i = first; i < first + tlbWays && victim == -1; i++)
+        if (!tlb[i].valid)
+            victim = i;
+
+    if (victim == -1) {
+        switch (tlbPolicy) {
+            case LRU_TLB_POLICY:
+            case FIFO_TLB_POLICY: {
+                victim = first;
+                for (unsigned i = first + 1; i < first + tlbWays; i++) {
+                    const TlbEntryState *e = &tlbState[i];
+                    const TlbEntryState *v = &tlbState[victim];
+                    if (tlbPolicy == LRU_TLB_POLICY
+                          ? e->lastUse < v->lastUse : e->loaded < v->loaded)
+                        victim = i;
+                }
+                break;
+            }
+
+            case CLOCK_TLB_POLICY:
+                while (tlbState[first + tlbHands[set]].referenced) {
+                    tlbState[first + tlbHands[set]].referenced = false;
+                    tlbHands[set] = (tlbHands[set] + 1) % tlbWays;
+                }
+                victim = first + tlbHands[set];
+                tlbHands[set] = (tlbHands[set] + 1) % tlbWays;
+                break;
+
+            case RANDOM_TLB_POLICY:
+                // Own generator, not to disturb the one behind `-rs`.
+                tlbRandom = tlbRandom * 1103515245 + 12345;
+                victim = first + (tlbRandom >> 16) % tlbWays;
+                break;
+
+            default:
+                ASSERT(false);
+        }
     }
 
-    unsigned pageFrame = entry->physicalPage;
+    WriteBackTlbEntry(victim);
 
-    // If the `pageFrame` is too big, there is something really wrong!  An
-    // invalid translation was loaded into the page table or TLB.
-    if (pageFrame >= NUM_PHYS_PAGES) {
-        DEBUG_CONT('a', "frame %u > %u!\n", pageFrame, NUM_PHYS_PAGES);
-        return BUS_ERROR_EXCEPTION;
+    // Whatever is loaded now starts afresh.
+    tlbState[victim].loaded     = ++tlbTime;
+    tlbState[victim].referenced = false;
+    return victim;
+}
+
+void
+MMU::WriteBackTlbEntry(unsigned i, bool leaving)
+{
+    ASSERT(i < tlbSize);
+
+    const TranslationEntry *entry = &tlb[i];
+    if (!entry->valid || entry->asid >= NUM_ASIDS)
+        return;
+    const PageTable *table = asidTables[entry->asid];
+    if (table == nullptr)
+        return;
+
+    // All the pages of a superpage share its bits.
+    unsigned last = entry->virtualPage + (1 << entry->pageShift);
+    for (unsigned vpn = entry->virtualPage;
+         vpn < last && vpn < table->GetSize(); vpn++) {
+        TranslationEntry *pte = table->Find(vpn);
+        if (pte == nullptr)
+            continue;
+        pte->use   = pte->use || entry->use;
+        pte->dirty = pte->dirty || entry->dirty;
+        if (leaving)
+            pte->inTLB = false;
     }
+}
 
-    // Set the `use` and `dirty` flags.
-    entry->use = true;
-    if (writing)
-        entry->dirty = true;
+void
+MMU::WriteBackTlbBits()
+{
+    if (tlb == nullptr)
+        return;
 
-    *physAddr = pageFrame * PAGE_SIZE + offset;
-    ASSERT(*physAddr >= 0 && *physAddr + size <= MEMORY_SIZE);
-    DEBUG_CONT('a', "physical address 0x%X\n", *physAddr);
-    return NO_EXCEPTION;
+    for (unsigned i = 0; i < tlbSize; i++) {
+        if (tlb[i].valid) {
+            WriteBackTlbEntry(i, false);
+            tlb[i].use = false;
+        }
+    }
+    // Remembered translations would skip setting `use` again.
+    FlushSoftTlb();
 }
 
-// Plancha 4 - Ejercicio 5
-// Get the least recently used TLB index
-#ifdef USE_TLB
-int 
-MMU::getTLBVictimPage(){
-    // LRU algorithm
-    for (size_t i = 0; i < TLB_SIZE; i++)
-    {
-        if(! tlb[i].valid)
-            return i;
-    }    
-    int i = tlbStack -> Pop();
-    return i;
+void
+MMU::SetAsidTable(unsigned asid, PageTable *table)
+{
+    ASSERT(asid < NUM_ASIDS);
+
+    asidTables[asid] = table;
+}
+
+void
+MMU::InvalidateTlb(unsigned asid)
+{
+    ASSERT(tlb != nullptr);
+
+    for (unsigned i = 0; i < tlbSize; i++) {
+        if (tlb[i].valid && tlb[i].asid == asid) {
+            WriteBackTlbEntry(i);
+            tlb[i].valid = false;
+        }
+    }
+    FlushSoftTlb();
+}
+
+void
+MMU::InvalidateTlbPage(unsigned asid, unsigned vpn)
+{
+    ASSERT(tlb != nullptr);
+
+    for (unsigned i = 0; i < tlbSize; i++) {
+        const TranslationEntry *e = &tlb[i];
+        if (e->valid && e->asid == asid
+              && e->virtualPage == vpn >> e->pageShift << e->pageShift) {
+            WriteBackTlbEntry(i);
+            tlb[i].valid = false;
+        }
+    }
+    FlushSoftTlb();
+}
+
+void
+MMU::InvalidateTlb()
+{
+    ASSERT(tlb != nullptr);
+
+    for (unsigned i = 0; i < tlbSize; i++) {
+        WriteBackTlbEntry(i);
+        tlb[i].valid = false;
+    }
+    FlushSoftTlb();
 }
-#endif
@@ -11,8 +11,9 @@
 
 #include "exception_type.hh"
 #include "disk.hh"
+#include "instruction_cache.hh"
+#include "page_table.hh"
 #include "translation_entry.hh"
-#include "lib/list.hh"
 
 
 
@@ -26,18 +27,52 @@ const unsigned NUM_PHYS_PAGES = 128;
 const unsigned MEMORY_SIZE = NUM_PHYS_PAGES * PAGE_SIZE;
 // Plancha 4 - Ejercicio 2
 const unsigned TLB_SIZE = 16;  ///< if there is a TLB, make it small.
+const unsigned NUM_ASIDS = 64;  ///< Address space identifiers, including
+                                ///< 0, which stands for none.
+
+/// How the MMU translates virtual addresses.
+enum TranslationMode {
+    PAGE_TABLE_TRANSLATION,  ///< Through the linear page table.
+    TLB_TRANSLATION          ///< Through the software-loaded TLB.
+};
+
+/// How the MMU picks the TLB entry to replace within a set.
+enum TlbPolicy {
+    LRU_TLB_POLICY,     ///< Least recently used.
+    CLOCK_TLB_POLICY,   ///< Second chance, by reference bits.
+    FIFO_TLB_POLICY,    ///< Oldest loaded.
+    RANDOM_TLB_POLICY,  ///< Any of them.
+    NUM_TLB_POLICIES
+};
+
+/// Return the policy named `name` (`lru`, `clock`, `fifo` or `random`), or
+/// `NUM_TLB_POLICIES` if there is no such policy.
+TlbPolicy TlbPolicyFromString(const char *name);
+
+/// The mode is fixed by the build: kernels built with `USE_TLB` manage the
+/// TLB, and the others fill page tables that the MMU reads.
+#ifdef USE_TLB
+const TranslationMode DEFAULT_TRANSLATION = TLB_TRANSLATION;
+#else
+const TranslationMode DEFAULT_TRANSLATION = PAGE_TABLE_TRANSLATION;
+#endif
 
 
 /// This class simulates an MMU (memory management unit) that can use either
 /// page tables or a TLB.
 class MMU {
 public:
-    // Initialize the MMU subsystem.
+    // Initialize the MMU subsystem, translating as `DEFAULT_TRANSLATION`
+    // says.
     MMU();
 
     // Deallocate data structures.
     ~MMU();
 
+    /// Return how addresses are translated.  Execution engines check it
+    /// once per run and then use the accesses specialized for it.
+    TranslationMode GetMode() const;
+
     /// Read or write 1, 2, or 4 bytes of virtual memory (at `addr`).  Return
     /// false if a correct translation could not be found.
 
@@ -45,6 +80,78 @@ public:
 
     ExceptionType WriteMem(unsigned addr, unsigned size, int value);
 
+    /// The same, for a translation mode and a size known at compile time,
+    /// so that there is nothing to select on each access.  `MODE` must be
+    /// the mode of the MMU (see `GetMode`).  Defined in `mmu_access.hh`.
+    template <TranslationMode MODE, unsigned SIZE>
+    ExceptionType ReadMem(unsigned addr, int *value);
+
+    template <TranslationMode MODE, unsigned SIZE>
+    ExceptionType WriteMem(unsigned addr, int value);
+
+    /// Same as above, but an access that would raise an exception is not
+    /// done at all, leaves no trace and just returns false.
+    template <TranslationMode MODE, unsigned SIZE>
+    bool TryReadMem(unsigned addr, int *value);
+
+    template <TranslationMode MODE, unsigned SIZE>
+    bool TryWriteMem(unsigned addr, int value);
+
+    /// Copy `count` bytes of virtual memory at `addr` into `buffer`, or
+    /// from `buffer` into virtual memory, translating once per page.
+    ///
+    /// Stops at the first address that cannot be accessed and returns the
+    /// exception; in any case, `*done` is how many bytes were copied.
+    ExceptionType ReadBlock(unsigned addr, char *buffer, unsigned count,
+                            unsigned *done);
+
+    ExceptionType WriteBlock(unsigned addr, const char *buffer,
+                             unsigned count, unsigned *done);
+
+    /// Store in `*length` the length of the string at `addr`, looking at
+    /// `max` bytes at most, and `max` if there is no null among them.
+    ///
+    /// On an exception, `*length` is how many bytes were looked at.
+    ExceptionType StringLength(unsigned addr, unsigned max,
+                               unsigned *length);
+
+    /// Fetch the already decoded instruction at virtual address `addr`.
+    ///
+    /// The translation is done as for a 4-byte read; the decoding is served
+    /// from the instruction cache whenever possible.  If `frame` is not
+    /// null, the physical page the instruction lives in is stored there.
+    /// `MODE` must be the mode of the MMU, as for `ReadMem`.
+    template <TranslationMode MODE>
+    ExceptionType ReadInstruction(unsigned addr, const Instruction **instr,
+                                  unsigned *frame = nullptr);
+
+    /// Account for `count` more fetches from the page of the last call to
+    /// `ReadInstruction`, without translating the address again.
+    ///
+    /// Execution engines that keep running inside one page use this so
+    /// that TLB statistics and replacement order stay the same as if every
+    /// instruction had been fetched with `ReadInstruction`.  If `touch` is
+    /// false, only the statistics are updated: the caller knows the last
+    /// access to the TLB was already for the instruction page, or that the
+    /// last instruction accessed data after being fetched.
+    void RepeatFetch(unsigned count = 1, bool touch = true);
+
+    const InstructionCache *GetInstructionCache() const;
+
+    /// Notify the MMU that the kernel has changed the contents of physical
+    /// page `frame` behind its back (e.g. by loading it from disk), so that
+    /// any cached information derived from it must be discarded.
+    void InvalidateFrame(unsigned frame);
+
+    /// Notify the MMU that the kernel has changed `pageTable`, `tlb`, or any
+    /// of their entries, so that the translations it keeps for itself must
+    /// be discarded.
+    ///
+    /// Translations are remembered by address space, so switching page
+    /// tables alone is safe; changing the `valid`, `use`, `dirty`,
+    /// `readOnly` or `physicalPage` fields of an entry is not.
+    void FlushSoftTlb();
+
     /// Data structures -- all of these are accessible to Nachos kernel code.
     /// “Public” for convenience.
     ///
@@ -62,7 +169,9 @@ public:
     /// * a software-loaded translation lookaside buffer (tlb) -- a cache of
     ///   mappings of virtual page #'s to physical page #'s.
     ///
-    /// If `tlb` is null, the linear page table is used.
+    /// If `tlb` is null, the page table is used.  Page tables have two
+    /// levels (see `page_table.hh`), so only the parts of the address space
+    /// that are mapped take up memory.
     /// If `tlb` is non-null, the Nachos kernel is responsible for managing
     /// the contents of the TLB.  But the kernel can use any data structure
     /// it wants (eg, segmented paging) for handling TLB cache misses.
@@ -76,30 +185,203 @@ public:
 
     TranslationEntry *tlb;  ///< This pointer should be considered
                             ///< “read-only” to Nachos kernel code.
+    unsigned tlbSize;       ///< Number of entries of `tlb`; read-only too.
+
+    /// Change the geometry and replacement policy of the TLB, dropping
+    /// all of its entries.  Only valid with a TLB.
+    ///
+    /// The TLB gets `size` entries in sets of `ways` (so 1 means direct
+    /// mapped and `size` fully associative).  Virtual page `vpn` can only
+    /// be loaded into set `vpn % (size / ways)`.
+    void ConfigureTlb(unsigned size, unsigned ways, TlbPolicy policy);
+
+    /// Address space identifiers.
+    ///
+    /// Every TLB entry is tagged with an ASID, and only those tagged with
+    /// `currentAsid` translate addresses, so the TLB can keep the entries
+    /// of several address spaces and needs no flush on context switches.
+    /// The kernel sets `asid` on the entries it loads.
+    unsigned currentAsid;
+
+    /// Make `table` the page table of `asid`, or forget it if `table` is
+    /// null.
+    ///
+    /// Whenever a TLB entry of `asid` is replaced or invalidated by the
+    /// MMU, its `use` and `dirty` bits are written back to the page table,
+    /// and the `inTLB` bit there is cleared.
+    void SetAsidTable(unsigned asid, PageTable *table);
+
+    /// Write back and invalidate the TLB entries of `asid`, or all of them.
+    void InvalidateTlb(unsigned asid);
+    void InvalidateTlb();
 
-    TranslationEntry *pageTable;
-    unsigned pageTableSize;
+    /// Write back and invalidate the TLB entries of `asid` that map virtual
+    /// page `vpn`, be it by itself or as part of a superpage.
+    void InvalidateTlbPage(unsigned asid, unsigned vpn);
+
+    /// Write the `use` and `dirty` bits of every TLB entry back to the page
+    /// tables, and clear the `use` bits in the TLB, so that page tables
+    /// show every reference made since the last call.  Does nothing
+    /// without a TLB.
+    void WriteBackTlbBits();
+
+    PageTable *pageTable;
+
+    /// Hardware refill of the TLB, MIPS style.
+    ///
+    /// If `hardwareRefill` is set, a TLB miss does not trap right away:
+    /// the MMU looks the page up in `refillTable`, the page table of the
+    /// running process as registered by the kernel, and if the entry is
+    /// valid and in memory it loads it into the TLB by itself.  Only misses
+    /// on pages that are not in memory raise `PAGE_FAULT_EXCEPTION`, so
+    /// `numPageFaults` counts real page faults in this mode.
+    ///
+    /// The entry replaced is chosen as the kernel does it, and its `use`
+    /// and `dirty` bits are written back to `refillTable`.  The `inTLB`
+    /// fields of both page table entries are kept up to date too.
+    bool hardwareRefill;
+    PageTable *refillTable;
+
+    /// Superpages.
+    ///
+    /// Besides single pages, TLB entries can map superpages of
+    /// `1 << superpageShift` pages (see `TranslationEntry::pageShift`), so
+    /// that a TLB of a given size covers that many times more memory.  A
+    /// superpage goes into the set of `virtualPage >> superpageShift`.  0
+    /// means no superpages.
+    unsigned superpageShift;
 
     // Plancha 4 - Ejercicio 5
-    int getTLBVictimPage();
+    /// Return the TLB entry to load the translation of virtual page `vpn`
+    /// into: an invalid entry of its set, or the one the policy chooses.
+    /// For a superpage, `vpn` is its first page and `shift` its
+    /// `pageShift`.
+    int getTLBVictimPage(unsigned vpn, unsigned shift = 0);
 
 private:
 
+    /// How addresses are translated.
+    TranslationMode mode;
+
+    /// `ReadMem` and `WriteMem` for a size only known at run time.
+    template <TranslationMode MODE>
+    ExceptionType ReadSized(unsigned addr, unsigned size, int *value);
+
+    template <TranslationMode MODE>
+    ExceptionType WriteSized(unsigned addr, unsigned size, int value);
+
+    /// Translate `addr` for a block operation, as a one byte access.
+    template <bool WRITING>
+    ExceptionType TranslateByte(unsigned addr, unsigned *physAddr);
+
+    /// Access `SIZE` bytes at virtual address `addr`.  If `PROBING`, an
+    /// access that would raise an exception leaves no trace.
+    template <TranslationMode MODE, unsigned SIZE, bool PROBING>
+    ExceptionType Read(unsigned addr, int *value);
+
+    template <TranslationMode MODE, unsigned SIZE, bool PROBING>
+    ExceptionType Write(unsigned addr, int value);
+
     /// Retrieve a page entry either from a page table or the TLB.
-    ExceptionType RetrievePageEntry(unsigned vpn,
-                                    TranslationEntry **entry) const;
+    template <TranslationMode MODE>
+    ExceptionType RetrievePageEntry(unsigned vpn, TranslationEntry **entry);
+
+    /// Return the index of the valid TLB entry for `vpn`, or -1.
+    int FindTlbEntry(unsigned vpn);
+
+    /// Look for an entry that maps `vpn` within a superpage of
+    /// `1 << shift` pages, or on its own if `shift` is 0.
+    int FindTlbEntry(unsigned vpn, unsigned shift);
+
+    /// Build `tlbHash` again from the contents of the TLB.
+    void HashTlb();
+
+    /// Note a use of TLB entry `i`, for replacement.
+    void TouchTlbEntry(int i);
+
+    /// Write the `use` and `dirty` bits of TLB entry `i` back to the page
+    /// table of its ASID, if it is valid.  If `leaving`, the entry is about
+    /// to be replaced or invalidated, and `inTLB` is cleared.
+    void WriteBackTlbEntry(unsigned i, bool leaving = true);
+
+    /// Page tables by ASID, see `SetAsidTable`.
+    PageTable *asidTables[NUM_ASIDS];
 
     /// Translate an address, and check for alignment.
     ///
     /// Set the use and dirty bits in the translation entry appropriately,
     /// and return an exception code if the translation could not be
     /// completed.
-    ExceptionType Translate(unsigned virtAddr, unsigned *physAddr,
-                            unsigned size, bool writing);
+    template <TranslationMode MODE, unsigned SIZE, bool WRITING,
+              bool PROBING>
+    ExceptionType Translate(unsigned virtAddr, unsigned *physAddr);
 
-    // Plancha 4 - Ejercicio 5
-    // List of TLB index order by least recently used
-    List<int> *tlbStack;
+    /// Update TLB statistics and replacement order after a lookup.
+    void RecordTlbAccess(const TranslationEntry *entry);
+
+    /// Load the translation of virtual page `vpn` into the TLB from
+    /// `refillTable`, if hardware refill is on and the page is in memory.
+    /// Returns the new TLB entry, or null.
+    ///
+    /// If `probing`, nothing is loaded unless the access would succeed.
+    TranslationEntry *RefillTlb(unsigned vpn, bool writing, bool probing);
+
+    /// Remember the translation of virtual page `vpn` through `entry`,
+    /// which was just used for an access.  Writes may hit only if
+    /// `writable`.
+    void FillSoftTlb(unsigned vpn, TranslationEntry *entry, bool writable);
+
+    /// TLB geometry and replacement policy.
+    unsigned tlbWays;
+    unsigned tlbSets;
+    TlbPolicy tlbPolicy;
+
+    /// What the replacement policies need to know about each TLB entry.
+    struct TlbEntryState {
+        unsigned long lastUse;  ///< Time of the last hit (LRU).
+        unsigned long loaded;   ///< Time it was chosen as victim (FIFO).
+        bool referenced;        ///< Hit since the hand last passed (clock).
+    };
+    TlbEntryState *tlbState;
+    unsigned long tlbTime;  ///< Advances at every use and every load.
+    unsigned *tlbHands;     ///< Clock hand of each set.
+    unsigned tlbRandom;     ///< State of the generator for random choices.
+
+    /// Index of the entries of a fully associative TLB, open addressed by
+    /// virtual page, with -1 for empty slots.  It is built again on the
+    /// first lookup after the kernel notifies any change with
+    /// `FlushSoftTlb`; entries invalidated meanwhile are just skipped.
+    int *tlbHash;
+    unsigned tlbHashSize;
+    bool tlbHashStale;
+
+    /// TLB entries used by the last translation and by the last instruction
+    /// fetch, or -1 if unknown.
+    int lastTlbHit;
+    int fetchTlbHit;
+
+    /// Decoded instructions, by physical page.
+    InstructionCache instructionCache;
+
+    /// A translation remembered by the MMU.
+    ///
+    /// An entry is only made after a successful translation, which already
+    /// set the `use` bit (and the `dirty` bit, if `writable`), so hits can
+    /// skip the page table or TLB lookup and go straight to memory.
+    struct SoftTlbEntry {
+        bool valid;
+        const PageTable *space;  ///< Page table it came from, or null
+                                 ///< when using the TLB.
+        unsigned asid;           ///< Address space, with a TLB.
+        unsigned vpn;
+        unsigned base;           ///< Physical address of the page.
+        bool writable;           ///< Whether writes may hit.
+        int tlbIndex;            ///< Entry of `tlb`, if any.
+    };
+
+    /// Translations, direct mapped by virtual page number.
+    static const unsigned SOFT_TLB_SIZE = 64;
+    SoftTlbEntry softTlb[SOFT_TLB_SIZE];
 };
 
 
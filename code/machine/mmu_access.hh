@@ -0,0 +1,286 @@
+/// Code of the accesses of the MMU that is specialized at compile time.
+///
+/// Every access is served by a template on its size and on the translation
+/// mode, so once those are known there is nothing left to decide.  The code
+/// is kept in this header so that the execution engines, which pick the
+/// mode once per run, can have it inlined at each call site.  Only the
+/// files that instantiate these templates need to include it.
+///
+/// DO NOT CHANGE -- part of the machine emulation
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_MACHINE_MMUACCESS__HH
+#define NACHOS_MACHINE_MMUACCESS__HH
+
+
+#include "mmu.hh"
+#include "endianness.hh"
+#include "threads/system.hh"
+
+
+template <TranslationMode MODE, unsigned SIZE>
+inline ExceptionType
+MMU::ReadMem(unsigned addr, int *value)
+{
+    static_assert(SIZE == 1 || SIZE == 2 || SIZE == 4, "bad access size");
+    ASSERT(MODE == mode);
+    return Read<MODE, SIZE, false>(addr, value);
+}
+
+template <TranslationMode MODE, unsigned SIZE>
+inline ExceptionType
+MMU::WriteMem(unsigned addr, int value)
+{
+    static_assert(SIZE == 1 || SIZE == 2 || SIZE == 4, "bad access size");
+    ASSERT(MODE == mode);
+    return Write<MODE, SIZE, false>(addr, value);
+}
+
+/// Like `ReadMem`, but if the access would raise an exception, leave no
+/// trace of it at all (not even in the statistics) and return false.
+///
+/// Used by execution engines that fall back to the interpreter to raise
+/// the exception themselves.
+template <TranslationMode MODE, unsigned SIZE>
+inline bool
+MMU::TryReadMem(unsigned addr, int *value)
+{
+    static_assert(SIZE == 1 || SIZE == 2 || SIZE == 4, "bad access size");
+    ASSERT(MODE == mode);
+    return Read<MODE, SIZE, true>(addr, value) == NO_EXCEPTION;
+}
+
+/// Like `WriteMem`, but if the access would raise an exception, leave no
+/// trace of it at all and return false.
+template <TranslationMode MODE, unsigned SIZE>
+inline bool
+MMU::TryWriteMem(unsigned addr, int value)
+{
+    static_assert(SIZE == 1 || SIZE == 2 || SIZE == 4, "bad access size");
+    ASSERT(MODE == mode);
+    return Write<MODE, SIZE, true>(addr, value) == NO_EXCEPTION;
+}
+
+/// Read `SIZE` bytes at `addr`, translated as `MODE` says.  If `PROBING`,
+/// a failed access leaves no trace.
+template <TranslationMode MODE, unsigned SIZE, bool PROBING>
+ExceptionType
+MMU::Read(unsigned addr, int *value)
+{
+    ASSERT(value != nullptr);
+
+    if (!PROBING)
+        DEBUG('a', "Reading VA 0x%X, size %u\n", addr, SIZE);
+
+    unsigned physicalAddress;
+    ExceptionType e = Translate<MODE, SIZE, false, PROBING>(addr,
+                                                             &physicalAddress);
+    if (e != NO_EXCEPTION)
+        return e;
+
+    *value = MemoryAccess<SIZE>::Load(&mainMemory[physicalAddress]);
+    if (!PROBING)
+        DEBUG('a', "\tValue read: %8.8X\n", *value);
+    return NO_EXCEPTION;
+}
+
+template <TranslationMode MODE, unsigned SIZE, bool PROBING>
+ExceptionType
+MMU::Write(unsigned addr, int value)
+{
+    if (!PROBING)
+        DEBUG('a', "Writing VA 0x%X, size %u, value 0x%X\n",
+              addr, SIZE, value);
+
+    unsigned physicalAddress;
+    ExceptionType e = Translate<MODE, SIZE, true, PROBING>(addr,
+                                                            &physicalAddress);
+    if (e != NO_EXCEPTION)
+        return e;
+
+    MemoryAccess<SIZE>::Store(&mainMemory[physicalAddress], value);
+
+    // Self-modifying code: drop the stale decoded instructions, if any.
+    unsigned frame = physicalAddress / PAGE_SIZE;
+    if (instructionCache.IsCached(frame))
+        instructionCache.Invalidate(frame);
+    return NO_EXCEPTION;
+}
+
+/// Fetch the decoded instruction at virtual address `addr` into `*instr`.
+///
+/// Returns the exception raised by the translation, if any; in that case
+/// `*instr` is left untouched.
+///
+/// * `addr` is the virtual address of the instruction.
+/// * `instr` is where to store a pointer to the decoded instruction.  It
+///   stays valid until the page is invalidated.
+/// * `frame`, if not null, is where to store the physical page number.
+template <TranslationMode MODE>
+ExceptionType
+MMU::ReadInstruction(unsigned addr, const Instruction **instr,
+                     unsigned *frame)
+{
+    ASSERT(instr != nullptr);
+
+    unsigned physicalAddress;
+    ExceptionType e = Translate<MODE, 4, false, false>(addr,
+                                                       &physicalAddress);
+    if (e != NO_EXCEPTION)
+        return e;
+
+    const Instruction *page
+      = instructionCache.GetFrame(physicalAddress / PAGE_SIZE, mainMemory);
+    *instr = &page[physicalAddress % PAGE_SIZE / 4];
+    if (frame != nullptr)
+        *frame = physicalAddress / PAGE_SIZE;
+    fetchTlbHit = lastTlbHit;
+    return NO_EXCEPTION;
+}
+
+template <TranslationMode MODE>
+ExceptionType
+MMU::RetrievePageEntry(unsigned vpn, TranslationEntry **entry)
+{
+    ASSERT(entry != nullptr);
+
+    if (MODE == PAGE_TABLE_TRANSLATION) {
+        // Use a page table; `vpn` is an index in the table.
+
+        if (vpn >= pageTable->GetSize()) {
+            DEBUG_CONT('a', "virtual page # %u too large for"
+                            " page table size %u!\n",
+                       vpn, pageTable->GetSize());
+            return ADDRESS_ERROR_EXCEPTION;
+        }
+        TranslationEntry *pte = pageTable->Find(vpn);
+        if (pte == nullptr || !pte->valid) {
+            DEBUG_CONT('a', "virtual page # %u too large for"
+                            " page table size %u!\n",
+                       vpn, pageTable->GetSize());
+            return PAGE_FAULT_EXCEPTION;
+        }
+
+        *entry = pte;
+        return NO_EXCEPTION;
+
+    } else {
+        // Use the TLB.
+        // Plancha 4 - Ejercicio 1
+        DEBUG('a', "Buscando VPN: '%d'\n", vpn);
+        int i = FindTlbEntry(vpn);
+        if (i != -1) {
+            DEBUG('a', "Page '%d' found with physical page %d\n",
+                  vpn, tlb[i].physicalPage);
+            *entry = &tlb[i];  // FOUND!
+            return NO_EXCEPTION;
+        }
+
+        // Not found.
+        DEBUG('a', "no valid TLB entry found for this virtual page!\n");
+        return PAGE_FAULT_EXCEPTION;  // Really, this is a TLB fault, the
+                                      // page may be in memory, but not in
+                                      // the TLB.
+    }
+}
+
+/// Translate a virtual address into a physical address, using
+/// either a page table or a TLB, as `MODE` says.
+///
+/// Check for alignment and all sorts of other errors, and if everything is
+/// ok, set the use/dirty bits in the translation table entry, and store the
+/// translated physical address in "physAddr".  If there was an error,
+/// returns the type of the exception.
+///
+/// * `virtAddr" is the virtual address to translate.
+/// * `physAddr" is the place to store the physical address.
+/// * `SIZE" is the amount of memory being read or written.
+/// * `WRITING` -- if true, check the “read-only” bit in the TLB.
+/// * `PROBING` -- if true, a failed translation has no side effects.
+template <TranslationMode MODE, unsigned SIZE, bool WRITING, bool PROBING>
+ExceptionType
+MMU::Translate(unsigned virtAddr, unsigned *physAddr)
+{
+    ASSERT(physAddr != nullptr);
+
+    // Fast path: a remembered translation, for an aligned access.
+    unsigned vpn = virtAddr / PAGE_SIZE;
+    const SoftTlbEntry *cached = &softTlb[vpn % SOFT_TLB_SIZE];
+    if (cached->valid && cached->vpn == vpn && cached->space == pageTable
+          && cached->asid == currentAsid && (cached->writable || !WRITING)
+          && (virtAddr & (SIZE - 1)) == 0) {
+        if (MODE == TLB_TRANSLATION) {
+            // Same bookkeeping as `RecordTlbAccess`.
+            stats->numPageFounds++;
+            TouchTlbEntry(cached->tlbIndex);
+            lastTlbHit = cached->tlbIndex;
+        }
+        *physAddr = cached->base + virtAddr % PAGE_SIZE;
+        return NO_EXCEPTION;
+    }
+
+    // We must have either a TLB or a page table, but not both!
+    ASSERT((tlb == nullptr) != (pageTable == nullptr));
+
+    DEBUG('a', "\tTranslate: ");
+
+    // Check for alignment errors.
+    if (virtAddr & (SIZE - 1)) {
+        DEBUG_CONT('a', "alignment problem at %u, size %u!\n",
+                   virtAddr, SIZE);
+        return ADDRESS_ERROR_EXCEPTION;
+    }
+
+    // Calculate the offset within the page from the virtual address.
+    unsigned offset = (unsigned) virtAddr % PAGE_SIZE;
+
+    TranslationEntry *entry = nullptr;
+    ExceptionType exception = RetrievePageEntry<MODE>(vpn, &entry);
+    if (MODE == TLB_TRANSLATION && exception == PAGE_FAULT_EXCEPTION) {
+        entry = RefillTlb(vpn, WRITING, PROBING);
+        if (entry != nullptr)
+            exception = NO_EXCEPTION;
+    }
+    unsigned pageFrame = 0;
+    if (exception == NO_EXCEPTION) {
+        // Superpages map `vpn` at some distance from their first page.
+        pageFrame = entry->physicalPage + vpn - entry->virtualPage;
+        if (entry->readOnly && WRITING) {  // Trying to write to a read-only
+                                           // page.
+            DEBUG_CONT('a', "%u mapped read-only!\n", virtAddr);
+            exception = READ_ONLY_EXCEPTION;
+        } else if (pageFrame >= NUM_PHYS_PAGES) {
+            // If the frame is too big, there is something really wrong!
+            // An invalid translation was loaded into the page table or TLB.
+            DEBUG_CONT('a', "frame %u > %u!\n",
+                       pageFrame, NUM_PHYS_PAGES);
+            exception = BUS_ERROR_EXCEPTION;
+        }
+    }
+    if (exception != NO_EXCEPTION && PROBING)
+        return exception;
+
+    if (MODE == TLB_TRANSLATION)
+        RecordTlbAccess(entry);
+    if (exception != NO_EXCEPTION)
+        return exception;
+
+    // Set the `use` and `dirty` flags.
+    entry->use = true;
+    if (WRITING)
+        entry->dirty = true;
+    // Writes can skip the lookup once the page is dirty.
+    FillSoftTlb(vpn, entry, entry->dirty && !entry->readOnly);
+
+    *physAddr = pageFrame * PAGE_SIZE + offset;
+    ASSERT(*physAddr >= 0 && *physAddr + SIZE <= MEMORY_SIZE);
+    DEBUG_CONT('a', "physical address 0x%X\n", *physAddr);
+    return NO_EXCEPTION;
+}
+
+
+#endif
@@ -0,0 +1,94 @@
+/// Copyright (c) 2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "page_table.hh"
+
+
+PageTable::PageTable()
+{
+    size      = 0;
+    directory = nullptr;
+}
+
+PageTable::~PageTable()
+{
+    Clear();
+}
+
+void
+PageTable::SetSize(unsigned numPages)
+{
+    Clear();
+
+    size = numPages;
+    unsigned numChunks = DivRoundUp(size, PAGE_TABLE_CHUNK);
+    directory = new TranslationEntry * [numChunks];
+    for (unsigned i = 0; i < numChunks; i++)
+        directory[i] = nullptr;
+}
+
+TranslationEntry &
+PageTable::operator[](unsigned vpn)
+{
+    ASSERT(vpn < size);
+
+    TranslationEntry *&chunk = directory[vpn / PAGE_TABLE_CHUNK];
+    if (chunk == nullptr) {
+        chunk = new TranslationEntry[PAGE_TABLE_CHUNK];
+        unsigned first = vpn - vpn % PAGE_TABLE_CHUNK;
+        for (unsigned i = 0; i < PAGE_TABLE_CHUNK; i++) {
+            chunk[i].virtualPage  = first + i;
+            chunk[i].physicalPage = -1;
+            chunk[i].valid        = false;
+            chunk[i].readOnly     = false;
+            chunk[i].use          = false;
+            chunk[i].dirty        = false;
+            chunk[i].inSwap       = false;
+            chunk[i].swapSlot     = 0;
+            chunk[i].inMemory     = false;
+            chunk[i].inTLB        = false;
+            chunk[i].pageShift    = 0;
+            chunk[i].asid         = 0;
+        }
+    }
+    return chunk[vpn % PAGE_TABLE_CHUNK];
+}
+
+TranslationEntry
+PageTable::Mapping(unsigned vpn) const
+{
+    const TranslationEntry *pte = Find(vpn);
+    ASSERT(pte != nullptr);
+
+    TranslationEntry mapping = *pte;
+    if (mapping.pageShift > 0) {
+        unsigned offset = vpn & ((1 << mapping.pageShift) - 1);
+        mapping.virtualPage  -= offset;
+        mapping.physicalPage -= offset;
+    }
+    return mapping;
+}
+
+unsigned
+PageTable::CountChunks() const
+{
+    unsigned count = 0;
+    for (unsigned i = 0; i < DivRoundUp(size, PAGE_TABLE_CHUNK); i++)
+        if (directory[i] != nullptr)
+            count++;
+    return count;
+}
+
+void
+PageTable::Clear()
+{
+    if (directory == nullptr)
+        return;
+    for (unsigned i = 0; i < DivRoundUp(size, PAGE_TABLE_CHUNK); i++)
+        delete [] directory[i];
+    delete [] directory;
+    directory = nullptr;
+    size      = 0;
+}
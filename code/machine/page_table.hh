@@ -0,0 +1,83 @@
+/// Two-level page tables.
+///
+/// A linear page table needs one entry for every page of the virtual
+/// address space, used or not.  Here, virtual page numbers are split in two:
+/// the high part selects an entry of a directory, which points to a
+/// second-level table of `PAGE_TABLE_CHUNK` entries selected by the low
+/// part.  Second-level tables are only allocated when one of their entries
+/// is first written, so a large address space that is mostly unused costs
+/// memory in proportion to the parts of it that are actually mapped.
+///
+/// Both the MMU and the kernel use this structure: the MMU walks it on
+/// every translation that misses its caches, and the kernel fills it.
+///
+/// Copyright (c) 2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_MACHINE_PAGETABLE__HH
+#define NACHOS_MACHINE_PAGETABLE__HH
+
+
+#include "translation_entry.hh"
+
+
+/// Number of entries of each second-level table.  Must be a power of two.
+const unsigned PAGE_TABLE_CHUNK = 32;
+
+class PageTable {
+public:
+
+    /// Create a table covering no pages at all.
+    PageTable();
+
+    ~PageTable();
+
+    /// Cover virtual pages 0 to `numPages - 1`, forgetting every entry.
+    void SetSize(unsigned numPages);
+
+    /// Return the number of virtual pages covered.
+    unsigned GetSize() const
+    {
+        return size;
+    }
+
+    /// Return the entry of virtual page `vpn`, or null if it was never
+    /// written, which means that the page is not valid.
+    TranslationEntry *Find(unsigned vpn) const
+    {
+        ASSERT(vpn < size);
+        TranslationEntry *chunk = directory[vpn / PAGE_TABLE_CHUNK];
+        return chunk != nullptr ? &chunk[vpn % PAGE_TABLE_CHUNK] : nullptr;
+    }
+
+    /// Return the entry of virtual page `vpn`, allocating its second-level
+    /// table if needed.
+    ///
+    /// Entries start out invalid and not in memory, with their
+    /// `virtualPage` set and no physical page.
+    TranslationEntry &operator[](unsigned vpn);
+
+    /// Return the translation of virtual page `vpn` to load into a TLB: the
+    /// entry of the page itself or, if the page is part of a superpage, one
+    /// that maps the whole superpage.  `vpn` must have an entry.
+    TranslationEntry Mapping(unsigned vpn) const;
+
+    /// Return the number of second-level tables allocated.
+    unsigned CountChunks() const;
+
+private:
+
+    /// Free every second-level table and the directory.
+    void Clear();
+
+    /// Number of virtual pages covered.
+    unsigned size;
+
+    /// One pointer per `PAGE_TABLE_CHUNK` virtual pages, null until some
+    /// page among them is written.
+    TranslationEntry **directory;
+};
+
+
+#endif
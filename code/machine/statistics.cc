@@ -22,6 +22,16 @@ Statistics::Statistics()
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     // Plancha 2 - Ejercicio 4
     numPageFaults = numPageFounds = numPacketsSent = numPacketsRecvd = 0;
+    numTlbRefills = 0;
+    numSwapReads = numSwapWrites = numPagesDropped = 0;
+    numSwapWriteRequests = 0;
+    numSuspensions = numPagesFreed = 0;
+    numPageLoads = numPagesAhead = numPagesAheadUsed = 0;
+    numSharedPages = 0;
+    numPagesForked = numPagesCopied = 0;
+    numPagesCompressed = numPagesSameFilled = 0;
+    numCompressedLoads = numCompressedWritebacks = 0;
+    numZeroPagesMapped = numZeroPagesFilled = 0;
 #ifdef DFS_TICKS_FIX
     tickResets = 0;
 #endif
@@ -46,6 +56,32 @@ Statistics::Print()
     // Plancha 4 - Ejercicio 2
     double faultAvg = ( (double) numPageFaults / (double) (numPageFounds + numPageFaults)) * 100;
     printf("Paging: faults %lu success %lu miss ratio %lf%%\n", numPageFaults, numPageFounds, faultAvg);
+    if (numTlbRefills > 0)
+        printf("TLB: refills by the MMU %lu\n", numTlbRefills);
+    if (numSwapReads + numSwapWrites + numPagesDropped > 0)
+        printf("Swap: pages read %lu, written %lu in %lu writes, "
+               "dropped clean %lu\n", numSwapReads, numSwapWrites,
+               numSwapWriteRequests, numPagesDropped);
+    if (numPageLoads > 0)
+        printf("Page-ins: faults %lu, pages loaded ahead %lu, used %lu\n",
+               numPageLoads, numPagesAhead, numPagesAheadUsed);
+    if (numSharedPages > 0)
+        printf("Shared text: pages found in memory %lu\n", numSharedPages);
+    if (numPagesForked > 0)
+        printf("Copy-on-write: pages shared %lu, copied %lu\n",
+               numPagesForked, numPagesCopied);
+    if (numPagesCompressed > 0)
+        printf("Compressed swap: pages stored %lu (same-filled %lu), "
+               "read %lu, written to swap %lu\n", numPagesCompressed,
+               numPagesSameFilled, numCompressedLoads,
+               numCompressedWritebacks);
+    if (numZeroPagesMapped > 0)
+        printf("Zero-fill: pages mapped to the zero frame %lu, written %lu\n",
+               numZeroPagesMapped, numZeroPagesFilled);
+    if (numSuspensions > 0)
+        printf("Load control: processes suspended %lu\n", numSuspensions);
+    if (numPagesFreed > 0)
+        printf("Page-out daemon: frames freed %lu\n", numPagesFreed);
     printf("Network I/O: packets received %lu, sent %lu\n",
            numPacketsRecvd, numPacketsSent);
 }
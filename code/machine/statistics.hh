@@ -50,6 +50,52 @@ public:
     // Plancha 4 - Ejercicio 2
     /// Number of virtual memory page succesfully found.
     unsigned long numPageFounds;
+
+    /// Number of TLB misses served by the MMU itself, without a page fault
+    /// (see `MMU::hardwareRefill`).
+    unsigned long numTlbRefills;
+
+    /// Number of pages read from and written to swap, and of writes made
+    /// to write them.
+    unsigned long numSwapReads;
+    unsigned long numSwapWrites;
+    unsigned long numSwapWriteRequests;
+
+    /// Number of clean pages taken out of memory without writing them.
+    unsigned long numPagesDropped;
+
+    /// Number of times load control suspended a process.
+    unsigned long numSuspensions;
+
+    /// Number of frames freed by the page-out daemon.
+    unsigned long numPagesFreed;
+
+    /// Number of page faults that loaded pages, and of pages loaded ahead
+    /// of use on them (fault-around), and used later.
+    unsigned long numPageLoads;
+    unsigned long numPagesAhead;
+    unsigned long numPagesAheadUsed;
+
+    /// Number of times a process found a shared code page already in
+    /// memory, and did not have to load it.
+    unsigned long numSharedPages;
+
+    /// Pages shared copy-on-write by `Fork`, and copied on a write.
+    unsigned long numPagesForked;
+    unsigned long numPagesCopied;
+
+    /// Pages kept compressed in memory instead of written to swap, those
+    /// of them all of one word, pages read back from there, and pages
+    /// written to swap to make room.
+    unsigned long numPagesCompressed;
+    unsigned long numPagesSameFilled;
+    unsigned long numCompressedLoads;
+    unsigned long numCompressedWritebacks;
+
+    /// Untouched pages mapped to the shared zero frame, and those of them
+    /// given a frame of their own when first written.
+    unsigned long numZeroPagesMapped;
+    unsigned long numZeroPagesFilled;
     
     /// Number of packets sent over the network.
     unsigned long numPacketsSent;
@@ -0,0 +1,552 @@
+/// Direct-threaded execution engine for the MIPS simulator.
+///
+/// The classic engine (`Machine::Run` in `mips_sim.cc`) translates the
+/// program counter, fetches the instruction and dispatches it through a big
+/// `switch` once per instruction.  This engine turns every physical page of
+/// code into *threaded code* instead: an array holding, for each word of the
+/// page, the address of the routine that executes it.  Those routines are
+/// labels inside `Machine::RunThreaded`, so going from one instruction to
+/// the next is a single indirect jump.
+///
+/// Code is split into basic blocks when a page is translated: a block ends
+/// after the delay slot of a branch or jump, or at the end of the page.
+/// Inside a block, instructions follow each other with no further checks;
+/// at the end of a block the engine looks at the new program counter and
+/// keeps going if it still lies inside the same page.
+///
+/// The architectural state is updated exactly as `ExecInstruction` does it
+/// (delayed loads and the branch delay registers included) and simulated
+/// time advances one tick per instruction, so both engines give the same
+/// results on the same NOFF binaries.  When ticks are batched, instructions
+/// are only counted until the next interrupt may be due, as in
+/// `Machine::RunBatch`.  Instructions fetched without a new translation are
+/// still accounted for in the TLB (see `MMU::RepeatFetch`).  The program
+/// counter is translated again whenever the kernel may have changed the
+/// mappings, that is, after an exception or after any interrupt handler
+/// ran.
+///
+/// Instructions that are rare, or that may raise an exception by
+/// themselves (overflow, misaligned accesses, system calls, unimplemented
+/// opcodes), are handed over to `ExecInstruction`.  Single stepping and the
+/// `m` debug flag use the per-instruction path.
+///
+/// Copyright (c) 2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "instruction.hh"
+#include "jit.hh"
+#include "machine.hh"
+#include "mmu_access.hh"
+#include "threads/system.hh"
+
+
+/// One instruction of threaded code.
+struct ThreadedSlot {
+    const void *handler;       ///< Label of the routine that executes it.
+    const Instruction *instr;  ///< The decoded instruction.
+    bool endsBlock;            ///< Whether the program counter must be
+                               ///< checked after executing it.
+};
+
+/// Finish the current instruction: do the delayed load, advance the
+/// program counters and go on to the next one.
+#define FINISH_LOAD(reg, val)                      \
+    do {                                           \
+        r[r[LOAD_REG]] = r[LOAD_VALUE_REG];        \
+        r[LOAD_REG] = (reg);                       \
+        r[LOAD_VALUE_REG] = (val);                 \
+        r[0] = 0;                                  \
+        r[PREV_PC_REG] = r[PC_REG];                \
+        r[PC_REG] = r[NEXT_PC_REG];                \
+        r[NEXT_PC_REG] = pcAfter;                  \
+        goto tick;                                 \
+    } while (0)
+
+#define FINISH()  FINISH_LOAD(0, 0)
+
+/// Jump to the routine of the instruction in slot `ip`.
+#define DISPATCH()                                 \
+    do {                                           \
+        in = ip->instr;                            \
+        pcAfter = r[NEXT_PC_REG] + 4;              \
+        goto *ip->handler;                         \
+    } while (0)
+
+void
+Machine::FreeThreadedCode()
+{
+    delete [] threadedCode;
+    delete [] threadedVersions;
+    threadedCode     = nullptr;
+    threadedVersions = nullptr;
+}
+
+/// Run the user program with threaded code.
+///
+/// Like `Run`, this never returns: the address space exits by doing the
+/// system call `Exit`.
+template <TranslationMode MODE>
+void
+Machine::RunThreaded()
+{
+    static const void *dispatch[MAX_OPCODE + 1];
+    if (dispatch[0] == nullptr) {
+        for (unsigned i = 0; i <= MAX_OPCODE; i++)
+            dispatch[i] = &&do_fallback;
+        dispatch[OP_ADD]    = &&do_add;
+        dispatch[OP_ADDI]   = &&do_addi;
+        dispatch[OP_ADDIU]  = &&do_addiu;
+        dispatch[OP_ADDU]   = &&do_addu;
+        dispatch[OP_AND]    = &&do_and;
+        dispatch[OP_ANDI]   = &&do_andi;
+        dispatch[OP_BEQ]    = &&do_beq;
+        dispatch[OP_BGEZ]   = &&do_bgez;
+        dispatch[OP_BGEZAL] = &&do_bgezal;
+        dispatch[OP_BGTZ]   = &&do_bgtz;
+        dispatch[OP_BLEZ]   = &&do_blez;
+        dispatch[OP_BLTZ]   = &&do_bltz;
+        dispatch[OP_BLTZAL] = &&do_bltzal;
+        dispatch[OP_BNE]    = &&do_bne;
+        dispatch[OP_DIV]    = &&do_div;
+        dispatch[OP_DIVU]   = &&do_divu;
+        dispatch[OP_J]      = &&do_j;
+        dispatch[OP_JAL]    = &&do_jal;
+        dispatch[OP_JALR]   = &&do_jalr;
+        dispatch[OP_JR]     = &&do_jr;
+        dispatch[OP_LB]     = &&do_lb;
+        dispatch[OP_LBU]    = &&do_lbu;
+        dispatch[OP_LH]     = &&do_lh;
+        dispatch[OP_LHU]    = &&do_lhu;
+        dispatch[OP_LUI]    = &&do_lui;
+        dispatch[OP_LW]     = &&do_lw;
+        dispatch[OP_MFHI]   = &&do_mfhi;
+        dispatch[OP_MFLO]   = &&do_mflo;
+        dispatch[OP_MTHI]   = &&do_mthi;
+        dispatch[OP_MTLO]   = &&do_mtlo;
+        dispatch[OP_MULT]   = &&do_mult;
+        dispatch[OP_MULTU]  = &&do_multu;
+        dispatch[OP_NOR]    = &&do_nor;
+        dispatch[OP_OR]     = &&do_or;
+        dispatch[OP_ORI]    = &&do_ori;
+        dispatch[OP_SB]     = &&do_sb;
+        dispatch[OP_SH]     = &&do_sh;
+        dispatch[OP_SLL]    = &&do_sll;
+        dispatch[OP_SLLV]   = &&do_sllv;
+        dispatch[OP_SLT]    = &&do_slt;
+        dispatch[OP_SLTI]   = &&do_slti;
+        dispatch[OP_SLTIU]  = &&do_sltiu;
+        dispatch[OP_SLTU]   = &&do_sltu;
+        dispatch[OP_SRA]    = &&do_sra;
+        dispatch[OP_SRAV]   = &&do_srav;
+        dispatch[OP_SRL]    = &&do_srl;
+        dispatch[OP_SRLV]   = &&do_srlv;
+        dispatch[OP_SUB]    = &&do_sub;
+        dispatch[OP_SUBU]   = &&do_subu;
+        dispatch[OP_SW]     = &&do_sw;
+        dispatch[OP_XOR]    = &&do_xor;
+        dispatch[OP_XORI]   = &&do_xori;
+    }
+
+    const unsigned WORDS_PER_PAGE = PAGE_SIZE / 4;
+    if (threadedCode == nullptr) {
+        threadedCode     = new ThreadedSlot [NUM_PHYS_PAGES * WORDS_PER_PAGE];
+        threadedVersions = new unsigned [NUM_PHYS_PAGES];
+        for (unsigned i = 0; i < NUM_PHYS_PAGES; i++)
+            threadedVersions[i] = 0;  // Pages are decoded at least once.
+    }
+
+    const InstructionCache *cache = mmu.GetInstructionCache();
+    Instruction *single = new Instruction;  // For the per-instruction path.
+    Jit *translator = jit != nullptr && jit->IsEnabled() ? jit : nullptr;
+    int *r = registers;
+
+    // Everything the routines use is declared here, since jumping to a
+    // label must not skip any initialization.
+    ThreadedSlot *page, *ip;
+    const Instruction *in, *first;
+    unsigned frame, vpn, exceptions, pc, urs, urt, imm;
+    int pcAfter, sum, diff, tmp, value;
+    long long product;
+    unsigned long long uproduct;
+    unsigned long limit, budget;
+    unsigned count;
+    ExceptionType e;
+
+    for (;;) {
+        BillInstructions();
+
+        // Resuming inside a delay slot whose branch lives in another page,
+        // single stepping and tracing all go one instruction at a time.
+        if (singleStepper != nullptr || debug.IsEnabled('m')
+              || r[NEXT_PC_REG] != r[PC_REG] + 4) {
+            OneInstruction<MODE>(single);
+            continue;
+        }
+
+        // Number of instructions that may run before the next tick that
+        // can fire an interrupt.
+        budget = batchTicks ? interrupt->InstructionsBeforeDue() : 0;
+
+        // Translate the program counter once for the whole page.
+        exceptions = exceptionCount;
+        e = mmu.ReadInstruction<MODE>(r[PC_REG], &first, &frame);
+        if (e != NO_EXCEPTION) {
+            RaiseException(e, r[PC_REG]);
+            continue;
+        }
+        pc   = r[PC_REG];
+        vpn  = pc / PAGE_SIZE;
+        page = &threadedCode[frame * WORDS_PER_PAGE];
+
+        if (threadedVersions[frame] != cache->GetVersion(frame)) {
+            const Instruction *decoded = first - pc % PAGE_SIZE / 4;
+            for (unsigned i = 0; i < WORDS_PER_PAGE; i++) {
+                unsigned op = decoded[i].opCode;
+                page[i].handler   = op <= MAX_OPCODE ? dispatch[op]
+                                                     : &&do_fallback;
+                page[i].instr     = &decoded[i];
+                page[i].endsBlock = i == WORDS_PER_PAGE - 1
+                  || (i > 0 && decoded[i - 1].IsControlTransfer());
+            }
+            threadedVersions[frame] = cache->GetVersion(frame);
+        }
+
+    block_start:
+        // Run translated code instead, if the JIT has any for this block.
+        // It accounts for the time by itself.
+        if (translator != nullptr
+              && r[LOAD_REG] == 0 && r[LOAD_VALUE_REG] == 0) {
+            BillInstructions();
+            limit = interrupt->InstructionsBeforeDue();
+            if (limit > 0) {
+                count = translator->Run(pc, frame, page[0].instr,
+                                        cache->GetVersion(frame), limit);
+                if (count > 0) {
+                    interrupt->AdvanceInstructions(count);
+                    continue;
+                }
+            }
+        }
+
+        ip = &page[pc % PAGE_SIZE / 4];
+        DISPATCH();
+
+    do_add:
+        sum = r[in->rs] + r[in->rt];
+        if (!((r[in->rs] ^ r[in->rt]) & SIGN_BIT)
+              && (r[in->rs] ^ sum) & SIGN_BIT)
+            goto do_fallback;  // Overflow.
+        r[in->rd] = sum;
+        FINISH();
+
+    do_addi:
+        sum = r[in->rs] + in->extra;
+        if (!((r[in->rs] ^ in->extra) & SIGN_BIT)
+              && (in->extra ^ sum) & SIGN_BIT)
+            goto do_fallback;  // Overflow.
+        r[in->rt] = sum;
+        FINISH();
+
+    do_addiu:
+        r[in->rt] = r[in->rs] + in->extra;
+        FINISH();
+
+    do_addu:
+        r[in->rd] = r[in->rs] + r[in->rt];
+        FINISH();
+
+    do_and:
+        r[in->rd] = r[in->rs] & r[in->rt];
+        FINISH();
+
+    do_andi:
+        r[in->rt] = r[in->rs] & (in->extra & 0xFFFF);
+        FINISH();
+
+    do_beq:
+        if (r[in->rs] == r[in->rt])
+            pcAfter = r[NEXT_PC_REG] + IndexToAddr(in->extra);
+        FINISH();
+
+    do_bgezal:
+        r[RET_ADDR_REG] = r[NEXT_PC_REG] + 4;
+    do_bgez:
+        if (!(r[in->rs] & SIGN_BIT))
+            pcAfter = r[NEXT_PC_REG] + IndexToAddr(in->extra);
+        FINISH();
+
+    do_bgtz:
+        if (r[in->rs] > 0)
+            pcAfter = r[NEXT_PC_REG] + IndexToAddr(in->extra);
+        FINISH();
+
+    do_blez:
+        if (r[in->rs] <= 0)
+            pcAfter = r[NEXT_PC_REG] + IndexToAddr(in->extra);
+        FINISH();
+
+    do_bltzal:
+        r[RET_ADDR_REG] = r[NEXT_PC_REG] + 4;
+    do_bltz:
+        if (r[in->rs] & SIGN_BIT)
+            pcAfter = r[NEXT_PC_REG] + IndexToAddr(in->extra);
+        FINISH();
+
+    do_bne:
+        if (r[in->rs] != r[in->rt])
+            pcAfter = r[NEXT_PC_REG] + IndexToAddr(in->extra);
+        FINISH();
+
+    do_div:
+        if (r[in->rt] == 0) {
+            r[LO_REG] = 0;
+            r[HI_REG] = 0;
+        } else {
+            r[LO_REG] = r[in->rs] / r[in->rt];
+            r[HI_REG] = r[in->rs] % r[in->rt];
+        }
+        FINISH();
+
+    do_divu:
+        urs = (unsigned) r[in->rs];
+        urt = (unsigned) r[in->rt];
+        if (urt == 0) {
+            r[LO_REG] = 0;
+            r[HI_REG] = 0;
+        } else {
+            tmp = urs / urt;
+            r[LO_REG] = tmp;
+            tmp = urs % urt;
+            r[HI_REG] = tmp;
+        }
+        FINISH();
+
+    do_jal:
+        r[RET_ADDR_REG] = r[NEXT_PC_REG] + 4;
+    do_j:
+        pcAfter = (pcAfter & 0xF0000000) | IndexToAddr(in->extra);
+        FINISH();
+
+    do_jalr:
+        r[in->rd] = r[NEXT_PC_REG] + 4;
+    do_jr:
+        pcAfter = r[in->rs];
+        FINISH();
+
+    do_lb:
+        tmp = r[in->rs] + in->extra;
+        if (!ReadMem<MODE, 1>(tmp, &value))
+            goto tick;
+        if (value & 0x80)
+            value |= 0xFFFFFF00;
+        else
+            value &= 0xFF;
+        FINISH_LOAD(in->rt, value);
+
+    do_lbu:
+        tmp = r[in->rs] + in->extra;
+        if (!ReadMem<MODE, 1>(tmp, &value))
+            goto tick;
+        value &= 0xFF;
+        FINISH_LOAD(in->rt, value);
+
+    do_lh:
+        tmp = r[in->rs] + in->extra;
+        if (tmp & 0x1)
+            goto do_fallback;  // Misaligned.
+        if (!ReadMem<MODE, 2>(tmp, &value))
+            goto tick;
+        if (value & 0x8000)
+            value |= 0xFFFF0000;
+        else
+            value &= 0xFFFF;
+        FINISH_LOAD(in->rt, value);
+
+    do_lhu:
+        tmp = r[in->rs] + in->extra;
+        if (tmp & 0x1)
+            goto do_fallback;  // Misaligned.
+        if (!ReadMem<MODE, 2>(tmp, &value))
+            goto tick;
+        value &= 0xFFFF;
+        FINISH_LOAD(in->rt, value);
+
+    do_lui:
+        r[in->rt] = in->extra << 16;
+        FINISH();
+
+    do_lw:
+        tmp = r[in->rs] + in->extra;
+        if (tmp & 0x3)
+            goto do_fallback;  // Misaligned.
+        if (!ReadMem<MODE, 4>(tmp, &value))
+            goto tick;
+        FINISH_LOAD(in->rt, value);
+
+    do_mfhi:
+        r[in->rd] = r[HI_REG];
+        FINISH();
+
+    do_mflo:
+        r[in->rd] = r[LO_REG];
+        FINISH();
+
+    do_mthi:
+        r[HI_REG] = r[in->rs];
+        FINISH();
+
+    do_mtlo:
+        r[LO_REG] = r[in->rs];
+        FINISH();
+
+    do_mult:
+        product = (long long) r[in->rs] * r[in->rt];
+        r[HI_REG] = (int) (product >> 32);
+        r[LO_REG] = (int) product;
+        FINISH();
+
+    do_multu:
+        uproduct = (unsigned long long) (unsigned) r[in->rs]
+                   * (unsigned) r[in->rt];
+        r[HI_REG] = (int) (uproduct >> 32);
+        r[LO_REG] = (int) uproduct;
+        FINISH();
+
+    do_nor:
+        r[in->rd] = ~(r[in->rs] | r[in->rt]);
+        FINISH();
+
+    do_or:
+        r[in->rd] = r[in->rs] | r[in->rt];
+        FINISH();
+
+    do_ori:
+        r[in->rt] = r[in->rs] | (in->extra & 0xFFFF);
+        FINISH();
+
+    do_sb:
+        if (!WriteMem<MODE, 1>((unsigned) (r[in->rs] + in->extra), r[in->rt]))
+            goto tick;
+        FINISH();
+
+    do_sh:
+        if (!WriteMem<MODE, 2>((unsigned) (r[in->rs] + in->extra), r[in->rt]))
+            goto tick;
+        FINISH();
+
+    do_sll:
+        r[in->rd] = r[in->rt] << in->extra;
+        FINISH();
+
+    do_sllv:
+        r[in->rd] = r[in->rt] << (r[in->rs] & 0x1F);
+        FINISH();
+
+    do_slt:
+        r[in->rd] = r[in->rs] < r[in->rt] ? 1 : 0;
+        FINISH();
+
+    do_slti:
+        r[in->rt] = r[in->rs] < in->extra ? 1 : 0;
+        FINISH();
+
+    do_sltiu:
+        urs = r[in->rs];
+        imm = in->extra;
+        r[in->rt] = urs < imm ? 1 : 0;
+        FINISH();
+
+    do_sltu:
+        urs = r[in->rs];
+        urt = r[in->rt];
+        r[in->rd] = urs < urt ? 1 : 0;
+        FINISH();
+
+    do_sra:
+        r[in->rd] = r[in->rt] >> in->extra;
+        FINISH();
+
+    do_srav:
+        r[in->rd] = r[in->rt] >> (r[in->rs] & 0x1F);
+        FINISH();
+
+    // Shifts are done on a signed temporary, exactly as `ExecInstruction`
+    // does, so that both engines compute the same values.
+    do_srl:
+        tmp = r[in->rt];
+        tmp >>= in->extra;
+        r[in->rd] = tmp;
+        FINISH();
+
+    do_srlv:
+        tmp = r[in->rt];
+        tmp >>= r[in->rs] & 0x1F;
+        r[in->rd] = tmp;
+        FINISH();
+
+    do_sub:
+        diff = r[in->rs] - r[in->rt];
+        if ((r[in->rs] ^ r[in->rt]) & SIGN_BIT
+              && (r[in->rs] ^ diff) & SIGN_BIT)
+            goto do_fallback;  // Overflow.
+        r[in->rd] = diff;
+        FINISH();
+
+    do_subu:
+        r[in->rd] = r[in->rs] - r[in->rt];
+        FINISH();
+
+    do_sw:
+        if (!WriteMem<MODE, 4>((unsigned) (r[in->rs] + in->extra), r[in->rt]))
+            goto tick;
+        FINISH();
+
+    do_xor:
+        r[in->rd] = r[in->rs] ^ r[in->rt];
+        FINISH();
+
+    do_xori:
+        r[in->rt] = r[in->rs] ^ (in->extra & 0xFFFF);
+        FINISH();
+
+    do_fallback:
+        // Let the interpreter deal with it, raising any exception.
+        ExecInstruction<MODE>(in);
+
+    tick:
+        // Advance simulated time, or just count the instruction if no
+        // interrupt can be due yet.
+        if (budget > 0 && exceptionCount == exceptions) {
+            budget--;
+            unbilled++;
+        } else {
+            BillInstructions();
+            if (interrupt->OneTick())
+                continue;
+        }
+
+        // Leave the page if the kernel was entered in any way, or if a
+        // store modified the code being run.
+        if (exceptionCount != exceptions || !cache->IsCached(frame))
+            continue;
+
+        if (!ip->endsBlock) {
+            ip++;
+            mmu.RepeatFetch();
+            DISPATCH();
+        }
+
+        // End of a basic block: follow the program counter if it did not
+        // leave the page.
+        pc = r[PC_REG];
+        if (pc / PAGE_SIZE != vpn || (unsigned) r[NEXT_PC_REG] != pc + 4)
+            continue;
+        mmu.RepeatFetch();
+        goto block_start;
+    }
+}
+
+template void Machine::RunThreaded<PAGE_TABLE_TRANSLATION>();
+template void Machine::RunThreaded<TLB_TRANSLATION>();
@@ -24,7 +24,9 @@
 /// The following class defines an entry in a translation table -- either
 /// in a page table or a TLB.
 ///
-/// Each entry defines a mapping from one virtual page to one physical page.
+/// Each entry defines a mapping from one virtual page to one physical page,
+/// or, in the TLB, from an aligned run of virtual pages to as many
+/// contiguous physical pages (a superpage).
 ///
 /// In addition, there are some extra bits for access control (valid and
 /// read-only) and some bits for usage information (use and dirty).
@@ -55,14 +57,33 @@ public:
     bool dirty;
 
     // Plancha 4 - Ejercicio 4
-    /// This page is stored in the Swap File
+    /// This page is stored in the Swap File.  Unless `dirty` is set too,
+    /// the copy there is up to date; pages never written to swap are as
+    /// in the executable.
     bool inSwap;
 
+    /// Slot of the swap area that holds the page, while `inSwap` is set
+    /// (see `vmem/swap_area.hh`).
+    unsigned swapSlot;
+
     /// This page is stored in the phisical memory
     bool inMemory;
 
     /// This page is stored in TLB
     bool inTLB;
+
+    /// Base 2 logarithm of the number of pages mapped, 0 for a single page.
+    ///
+    /// A superpage maps the `1 << pageShift` pages starting at
+    /// `virtualPage`, which must be aligned to that many pages, to the
+    /// frames starting at `physicalPage`.  In page tables, every page keeps
+    /// its own entry and frame; a non-zero value marks the pages of a
+    /// superpage (see `PageTable::Mapping`).
+    unsigned pageShift;
+
+    /// Address space the translation belongs to, in the TLB (see
+    /// `MMU::currentAsid`).  Ignored in page tables.
+    unsigned asid;
 };
 
 
@@ -11,7 +11,11 @@
 /// =====
 ///
 ///     nachos [-d <debugflags>] [-p] [-rs <random seed #>] [-z]
-///            [-s] [-x <nachos file>] [-tc <consoleIn> <consoleOut>]
+///            [-s] [-ee <engine>] [-aot <module>] [-bt] [-ss <bytes>] [-hr]
+///            [-tlb <entries> <ways> <policy>] [-sp <order>] [-rp <policy>]
+///            [-lc] [-pd] [-fa <pages>] [-zs <frames>]
+///            [-x <nachos file>]
+///            [-tc <consoleIn> <consoleOut>]
 ///            [-f] [-cp <unix file> <nachos file>] [-pr <nachos file>]
 ///            [-rm <nachos file>] [-ls] [-D] [-c] [-tf]
 ///            [-n <network reliability>] [-id <machine id>]
@@ -30,6 +34,39 @@
 /// ----------------------
 ///
 /// * `-s`  -- causes user programs to be executed in single-step mode.
+/// * `-ee` -- selects how user instructions are executed: `interp` (the
+///   default) decodes and runs one instruction at a time, `threaded` runs
+///   pre-decoded basic blocks, and `jit` also translates hot blocks into
+///   host code.
+/// * `-aot` -- runs code translated ahead of time by `bin/noff2c` wherever
+///   it is found, with the threaded engine unless `jit` was selected.
+/// * `-bt` -- advances simulated time for user instructions in batches, up
+///   to the next pending interrupt, instead of after each one.  Timing is
+///   the same either way.
+/// * `-ss` -- sets how far user stacks may grow, in bytes.  Stack pages
+///   only take memory once written.  The default is `USER_STACK_SIZE`, and
+///   stacks may take at most `MAX_STACK_PAGES` pages.
+/// * `-hr` -- with a TLB, lets the MMU load the TLB from the page table of
+///   the running process, so that only misses on pages not in memory trap
+///   to the kernel.
+/// * `-tlb` -- with a TLB, sets its number of entries, its associativity
+///   (entries per set) and its replacement policy: `lru`, `clock`, `fifo`
+///   or `random`.  The default is `16 16 lru`.
+/// * `-sp` -- with a TLB, maps aligned regions of `2^order` pages with a
+///   single TLB entry whenever they can be given contiguous frames.
+/// * `-rp` -- with a TLB, sets the page replacement policy used when
+///   memory is full: `fifo`, `clock`, `enhanced` (second chance, preferring
+///   clean pages), `wsclock`, `aging` or `arc`.  The default is `clock`.
+/// * `-lc` -- with a TLB, suspends processes while the frames they need, as
+///   estimated from how often they fault, add up to more than memory.
+/// * `-pd` -- with a TLB, starts a page-out daemon that keeps some frames
+///   free, writing dirty pages to swap in clusters.
+/// * `-fa` -- with a TLB, loads up to that many pages on a page fault: the
+///   faulting one and those after it, as long as there are free frames.
+///   The window adapts to how many of them get used.  The default is 1.
+/// * `-zs` -- with a TLB, sets that many frames aside to keep pages taken
+///   out of memory compressed, writing to swap only those unused for
+///   longest when they run out.
 /// * `-x`  -- runs a user program.
 /// * `-tc` -- tests the console.
 ///
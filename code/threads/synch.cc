@@ -204,10 +204,11 @@ void
 Condition::Signal()
 {
     DEBUG('s', "Thread: %s make a signal\n", currentThread -> GetName());
-    Semaphore *s = sem_queue -> Pop();
-    // Si no hay receivers esperando, se rompe (caso joineable nadie hace join)
-    ASSERT(s != nullptr);
-    s -> V();
+    // Nobody waiting: as with any condition variable, the signal is lost.
+    // A `Channel` sender may get here before its receiver waits.
+    if (sem_queue -> IsEmpty())
+        return;
+    sem_queue -> Pop() -> V();
 }
 
 /// Plancha 2 - Ejercicio 1
@@ -14,6 +14,7 @@
 #include "userprog/exception.hh"
 #endif
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -48,9 +49,20 @@ Machine *machine;  ///< User program memory and registers.
 // Plancha 3 - Ejercicio 3
 SynchConsole *synchConsole;
 Bitmap *mapTable;
+CowMap *cowMap;
+unsigned zeroFrame;
+unsigned userStackLimit;
 Table <Thread*> *userProgTable;
 #endif
 
+#ifdef USE_TLB
+CoreMap *coreMap;
+LoadControl *loadControl;
+PageOutDaemon *pageOutDaemon;
+unsigned faultAroundPages;
+SwapArea *swapArea;
+#endif
+
 #ifdef NETWORK
 PostOffice *postOffice;
 #endif
@@ -106,6 +118,21 @@ Initialize(int argc, char **argv)
 
 #ifdef USER_PROGRAM
     bool debugUserProg = false;  // Single step user program.
+    ExecutionEngine engine = INTERPRETED_ENGINE;  // How to run user code.
+    const char *translatedCode = nullptr;  // Module made by `noff2c`.
+    bool batchTicks = false;  // Advance user time in batches.
+    userStackLimit = USER_STACK_SIZE;  // How far user stacks may grow.
+#ifdef USE_TLB
+    bool hardwareRefill = false;  // Let the MMU serve TLB misses.
+    bool suspendProcesses = false;  // Load control.
+    bool pageOut = false;  // Free frames in the background.
+    unsigned compressedFrames = 0;  // Pool of compressed swap pages.
+    unsigned superpageShift = 0;  // Pages per superpage, as a power of 2.
+    unsigned tlbSize = TLB_SIZE, tlbWays = TLB_SIZE;  // TLB geometry.
+    TlbPolicy tlbPolicy = LRU_TLB_POLICY;
+    PagePolicy pagePolicy = CLOCK_PAGE_POLICY;  // Page replacement.
+    faultAroundPages = 1;  // Just the faulting page.
+#endif
 #endif
 #ifdef FILESYS_NEEDED
     bool format = false;  // Format disk.
@@ -144,6 +171,85 @@ Initialize(int argc, char **argv)
 #ifdef USER_PROGRAM
         if (!strcmp(*argv, "-s"))
             debugUserProg = true;
+        else if (!strcmp(*argv, "-ee")) {
+            ASSERT(argc > 1);
+            engine = ExecutionEngineFromString(*(argv + 1));
+            if (engine == NUM_EXECUTION_ENGINES) {
+                fprintf(stderr, "Unknown execution engine `%s`.\n",
+                        *(argv + 1));
+                ASSERT(false);
+            }
+            argCount = 2;
+        } else if (!strcmp(*argv, "-bt"))
+            batchTicks = true;
+        else if (!strcmp(*argv, "-ss")) {
+            ASSERT(argc > 1);
+            char *end;
+            unsigned long limit = strtoul(*(argv + 1), &end, 10);
+            if (*end != '\0' || limit == 0
+                  || limit > (unsigned long) MAX_STACK_PAGES * PAGE_SIZE) {
+                fprintf(stderr, "Invalid user stack limit `%s`, it must be "
+                        "between 1 and %lu bytes.\n", *(argv + 1),
+                        (unsigned long) MAX_STACK_PAGES * PAGE_SIZE);
+                ASSERT(false);
+            }
+            userStackLimit = limit;
+            argCount = 2;
+        }
+#ifdef USE_TLB
+        else if (!strcmp(*argv, "-hr"))
+            hardwareRefill = true;
+        else if (!strcmp(*argv, "-lc"))
+            suspendProcesses = true;
+        else if (!strcmp(*argv, "-pd"))
+            pageOut = true;
+        else if (!strcmp(*argv, "-fa")) {
+            ASSERT(argc > 1);
+            faultAroundPages = atoi(*(argv + 1));
+            ASSERT(0 < faultAroundPages
+                     && faultAroundPages <= MAX_FAULT_AROUND);
+            argCount = 2;
+        }
+        else if (!strcmp(*argv, "-zs")) {
+            ASSERT(argc > 1);
+            compressedFrames = atoi(*(argv + 1));
+            ASSERT(compressedFrames < NUM_PHYS_PAGES / 2);
+            argCount = 2;
+        }
+        else if (!strcmp(*argv, "-sp")) {
+            ASSERT(argc > 1);
+            superpageShift = atoi(*(argv + 1));
+            ASSERT((1u << superpageShift) <= NUM_PHYS_PAGES);
+            argCount = 2;
+        }
+        else if (!strcmp(*argv, "-tlb")) {
+            ASSERT(argc > 3);
+            tlbSize = atoi(*(argv + 1));
+            tlbWays = atoi(*(argv + 2));
+            tlbPolicy = TlbPolicyFromString(*(argv + 3));
+            if (tlbPolicy == NUM_TLB_POLICIES) {
+                fprintf(stderr, "Unknown TLB replacement policy `%s`.\n",
+                        *(argv + 3));
+                ASSERT(false);
+            }
+            argCount = 4;
+        }
+        else if (!strcmp(*argv, "-rp")) {
+            ASSERT(argc > 1);
+            pagePolicy = PagePolicyFromString(*(argv + 1));
+            if (pagePolicy == NUM_PAGE_POLICIES) {
+                fprintf(stderr, "Unknown page replacement policy `%s`.\n",
+                        *(argv + 1));
+                ASSERT(false);
+            }
+            argCount = 2;
+        }
+#endif
+        else if (!strcmp(*argv, "-aot")) {
+            ASSERT(argc > 1);
+            translatedCode = *(argv + 1);
+            argCount = 2;
+        }
 #endif
 #ifdef FILESYS_NEEDED
         if (!strcmp(*argv, "-f"))
@@ -191,10 +297,35 @@ Initialize(int argc, char **argv)
 
 #ifdef USER_PROGRAM
     Debugger *d = debugUserProg ? new Debugger : nullptr;
-    machine = new Machine(d);  // This must come first.
+    machine = new Machine(d, engine, batchTicks);  // This must come first.
+    if (translatedCode != nullptr
+          && !machine->LoadTranslatedCode(translatedCode)) {
+        fprintf(stderr, "Cannot load translated code from `%s`.\n",
+                translatedCode);
+        ASSERT(false);
+    }
+#ifdef USE_TLB
+    machine->GetMMU()->hardwareRefill = hardwareRefill;
+    machine->GetMMU()->superpageShift = superpageShift;
+    machine->GetMMU()->ConfigureTlb(tlbSize, tlbWays, tlbPolicy);
+#endif
     // Plancha 3 - Ejercicio 3
     synchConsole = new SynchConsole(NULL, NULL);
     mapTable = new Bitmap(NUM_PHYS_PAGES);
+    cowMap = new CowMap(NUM_PHYS_PAGES);
+    // Nadie escribe este marco: las páginas que lo usan son de solo lectura
+    zeroFrame = mapTable->Find();
+    memset(&machine->GetMMU()->mainMemory[zeroFrame * PAGE_SIZE], 0,
+           PAGE_SIZE);
+#ifdef USE_TLB
+    coreMap = new CoreMap(NUM_PHYS_PAGES, pagePolicy);
+    // Every frame but the compressed pool and the zero frame.
+    loadControl = suspendProcesses
+                  ? new LoadControl(NUM_PHYS_PAGES - compressedFrames - 1)
+                  : nullptr;
+    pageOutDaemon = pageOut ? new PageOutDaemon(PAGE_OUT_LOW, PAGE_OUT_HIGH)
+                            : nullptr;
+#endif
     userProgTable = new Table<Thread*>;
     SetExceptionHandlers();
 #endif
@@ -206,6 +337,9 @@ Initialize(int argc, char **argv)
 #ifdef FILESYS_NEEDED
     fileSystem = new FileSystem(format);
 #endif
+#ifdef USE_TLB
+    swapArea = new SwapArea("SWAP", NUM_SWAP_SLOTS, compressedFrames);
+#endif
 
 #ifdef NETWORK
     postOffice = new PostOffice(netname, rely, 10);
@@ -226,14 +360,22 @@ Cleanup()
 #endif
 
 #ifdef USER_PROGRAM
+    // Plancha 4 - Ejercicio 4
+    // The address space gives its frames back to the structures below.
+    delete currentThread->space;
+    currentThread->space = nullptr;
     delete machine;
     // Plancha 3 - Ejercicio 3
     delete synchConsole;
     delete mapTable;
+    delete cowMap;
+#ifdef USE_TLB
+    delete pageOutDaemon;
+    delete loadControl;
+    delete coreMap;
+    delete swapArea;
+#endif
     delete userProgTable;
-    // Plancha 4 - Ejercicio 4
-    delete currentThread->space;
-
 #endif
 
 #ifdef FILESYS_NEEDED
@@ -39,12 +39,31 @@ extern Timer *timer;                 ///< The hardware alarm clock.
 #include "lib/bitmap.hh"
 #include "lib/table.hh"
 #include "filesys/open_file.hh"
+#include "userprog/cow_map.hh"
 extern Machine *machine;  			// User program memory and registers.
 extern SynchConsole *synchConsole;  // User program console.
 extern Bitmap *mapTable;
+extern CowMap *cowMap;  ///< Frames shared copy-on-write.
+extern unsigned zeroFrame;  ///< Frame of zeros, mapped read-only by every
+                            ///< page not yet written.
+extern unsigned userStackLimit;  ///< Most bytes a user stack may grow to.
 extern Table <Thread*> *userProgTable;
 #endif
 
+#ifdef USE_TLB
+#include "vmem/core_map.hh"
+#include "vmem/load_control.hh"
+#include "vmem/page_out_daemon.hh"
+#include "vmem/swap_area.hh"
+extern CoreMap *coreMap;  ///< Contents of every frame.
+extern LoadControl *loadControl;  ///< Null unless processes may be
+                                  ///< suspended.
+extern PageOutDaemon *pageOutDaemon;  ///< Null unless frames are freed
+                                      ///< in the background.
+extern unsigned faultAroundPages;  ///< Most pages loaded per page fault.
+extern SwapArea *swapArea;  ///< Where pages go out of memory.
+#endif
+
 #ifdef FILESYS_NEEDED  // *FILESYS* or *FILESYS_STUB*.
 #include "filesys/file_system.hh"
 extern FileSystem *fileSystem;
@@ -0,0 +1,25 @@
+/// Test program to write the last word of the uninitialized data.
+///
+/// The array is aligned to a page, so there is a gap between the
+/// initialized data and it, and it ends right before the guard pages below
+/// the stack.  Writing its last word must not be taken for a stack
+/// overflow.
+
+
+#include "syscall.h"
+
+
+/// Size of a page, as in `machine/mmu.hh`.
+#define PAGE  128
+
+static int seed = 7;
+static int tail[PAGE / sizeof (int)] __attribute__((aligned(PAGE)));
+
+int
+main(void)
+{
+    unsigned last = PAGE / sizeof (int) - 1;
+
+    tail[last] = seed;
+    return tail[last];
+}
@@ -0,0 +1,31 @@
+/// Test program for `Fork`.
+///
+/// The child changes a global variable and exits with its new value.  The
+/// parent joins it, gets that value back as the exit status, and checks
+/// that its own copy of the variable did not change.  Exits with 0 if
+/// everything went right.
+
+
+#include "syscall.h"
+
+
+static int shared = 1;
+
+int
+main(void)
+{
+    SpaceId child = Fork();
+
+    if (child == 0) {
+        shared = 42;
+        Exit(shared);
+    }
+    if (child < 0)
+        return -1;
+
+    if (Join(child) != 42)
+        return 1;
+    if (shared != 1)
+        return 2;
+    return 0;
+}
@@ -13,9 +13,19 @@
 #include <string.h>
 #include <stdio.h>
 
+
+#ifdef USE_TLB
+/// ASIDs are handed out in order as address spaces are switched to.  When
+/// they run out, the TLB is flushed and a new generation starts, so that
+/// every address space gets a fresh ASID the next time it runs; the ASIDs
+/// of finished processes are thus recycled without any bookkeeping.
+static unsigned currentAsidGeneration = 1;
+static unsigned nextAsid = 1;  // 0 is for no address space.
+#endif
+
 // Plancha 3 - Ejercicio 3
 /// return the phiysical address related to a virtual address by a TranslationEntry
-unsigned AddressTranslation(uint32_t virtualAddr,TranslationEntry* pageTable){
+unsigned AddressTranslation(uint32_t virtualAddr,PageTable &pageTable){
    DEBUG('a',"virtual address %u\n",virtualAddr);
    unsigned offset = virtualAddr % PAGE_SIZE;
 
@@ -28,7 +38,7 @@ unsigned AddressTranslation(uint32_t virtualAddr,TranslationEntry* pageTable){
 /// First, set up the translation from program memory to physical memory.
 /// For now, this is really simple (1:1), since we are only uniprogramming,
 /// and we have a single unsegmented page table.
-AddressSpace::AddressSpace(OpenFile *executable_file)
+AddressSpace::AddressSpace(OpenFile *executable_file, const char *name)
 {
     ASSERT(executable_file != nullptr);
 
@@ -37,64 +47,82 @@ AddressSpace::AddressSpace(OpenFile *executable_file)
     ASSERT(exe->CheckMagic());
     // How big is address space?
 
-    unsigned size = exe->GetSize() + USER_STACK_SIZE;
-      // We need to increase the size to leave room for the stack.
-    numPages = DivRoundUp(size, PAGE_SIZE);
-    size = numPages * PAGE_SIZE;
+    // Lo que no cubren el código ni los datos inicializados empieza en cero
+    uint32_t codeEnd = exe->GetCodeAddr() + exe->GetCodeSize();
+    uint32_t dataEnd = exe->GetInitDataAddr() + exe->GetInitDataSize();
+    firstZeroPage = DivRoundUp(codeEnd > dataEnd ? codeEnd : dataEnd,
+                               PAGE_SIZE);
 
-    // Table <OpenFile*> *filesTable;
-    processOpenFiles = new Table<OpenFile*>;
-    // Console Input y Output
-    processOpenFiles -> Add(nullptr);
-    processOpenFiles -> Add(nullptr);
+    // After the program, the guard pages and room for the stack to grow.
+    // The segments may leave gaps between them, so the image ends where the
+    // last of them does, not after `exe->GetSize()` bytes.
+    uint32_t bssEnd = exe->GetUninitDataAddr() + exe->GetUninitDataSize();
+    firstGuardPage = DivRoundUp(bssEnd, PAGE_SIZE);
+    if (firstGuardPage < firstZeroPage)
+        firstGuardPage = firstZeroPage;
+    firstStackPage = firstGuardPage + STACK_GUARD_PAGES;
+    numPages = firstStackPage + DivRoundUp(userStackLimit, PAGE_SIZE);
+    ASSERT(numPages <= MAX_USER_PAGES);
+    unsigned size = numPages * PAGE_SIZE;
 
-    #ifdef USE_TLB
-    tlbLocal = new TranslationEntry[TLB_SIZE];
-    for (unsigned i = 0; i < TLB_SIZE; i++)
-        tlbLocal[i].valid = false;
-    // Plancha 4 - Ejercicio 4
-    sprintf(swapName, "swap%d.asid", fileSystem->GetFileIndex());
-    DEBUG('a', "Creating Swap File '%s'\n", swapName);
-    ASSERT(fileSystem->Create(swapName, numPages * PAGE_SIZE, false));
-    swapFile = fileSystem->Open(swapName);
-    #endif
+    initState();
 
     // Plancha 3 - Ejercicio 3
     DEBUG('a', "Cantidad de páginas que ocupa el programa %u\n", numPages);
-    #ifndef USE_TLB
-        ASSERT(numPages <= mapTable->CountClear());
-    #endif
-      // Check we are not trying to run anything too big -- at least until we
-      // have virtual memory.
 
     DEBUG('a', "Initializing address space, num pages %u, size %u\n",
           numPages, size);
 
     // First, set up the translation.
 
-    pageTable = new TranslationEntry[numPages];
+    // Entries start out invalid; with a TLB, pages are only mapped when
+    // first touched, so the parts of the table that cover pages never
+    // touched are not even allocated.
+    pageTable.SetSize(numPages);
+
+    // Las páginas de puro código se comparten con los demás procesos del
+    // mismo ejecutable
+    text = name != nullptr ? SharedText::Attach(name, exe, this) : nullptr;
+
+    // Plancha 4 - Ejercicio 3
+    #ifndef USE_TLB
+    // Páginas de código que ya cargó otro proceso.  Las que empiezan en
+    // cero no ocupan un marco hasta que se las escribe
+    Bitmap sharedLoaded(numPages);
+    unsigned framesNeeded = 0;
+    for (unsigned i = 0; i < numPages; i++)
+        if (isSharedPage(i) && text->GetFrame(i) != -1)
+            sharedLoaded.Mark(i);
+        else if (!isZeroFillPage(i) && !IsGuardPage(i))
+            framesNeeded++;
+
+    ASSERT(framesNeeded <= mapTable->CountClear());
+      // Check we are not trying to run anything too big -- at least until we
+      // have virtual memory.
+
     for (unsigned i = 0; i < numPages; i++) {
-        pageTable[i].virtualPage  = i;
-        // For nowe, virtual page number = physical page number.
-        // Plancha 4 - Ejercicio 3
-        #ifdef USE_TLB
-        pageTable[i].physicalPage = -1;
-        pageTable[i].valid        = false;
-        #else
+        if (IsGuardPage(i))
+            continue;  // Sin entrada: no son válidas.
+        if (isZeroFillPage(i)) {
+            mapZeroPage(i);
+            continue;
+        }
         // Plancha 3 - Ejercicio 3
-        int pageNumber = mapTable->Find();
-        ASSERT(pageNumber != -1);
+        int pageNumber;
+        if (sharedLoaded.Test(i))
+            pageNumber = text->GetFrame(i);
+        else {
+            pageNumber = mapTable->Find();
+            ASSERT(pageNumber != -1);
+            if (isSharedPage(i))
+                text->SetFrame(i, pageNumber);
+        }
         pageTable[i].physicalPage = pageNumber;
         pageTable[i].valid        = true;
-        #endif
-        pageTable[i].use          = false;
-        pageTable[i].dirty        = false;
-        pageTable[i].readOnly     = false;
-        pageTable[i].inMemory     = false;
-        pageTable[i].inTLB        = false;
-          // If the code segment was entirely on a separate page, we could
-          // set its pages to be read-only.
+        pageTable[i].inMemory     = true;
+        pageTable[i].readOnly     = isSharedPage(i);
     }
+    #endif
 
     // Plancha 4 - Ejercicio 3
     #ifndef USE_TLB
@@ -105,8 +133,12 @@ AddressSpace::AddressSpace(OpenFile *executable_file)
 
     // Plancha 3 - Ejercicio 3
     for (unsigned i = 0; i < numPages; i++) {
+        if (sharedLoaded.Test(i) || isZeroFillPage(i) || IsGuardPage(i))
+            continue;
         unsigned physicalAddr = pageTable[i].physicalPage * PAGE_SIZE;
         memset(&mainMemory[physicalAddr], 0, PAGE_SIZE);
+        // The frame may still hold decoded code from a previous process.
+        machine->GetMMU()->InvalidateFrame(pageTable[i].physicalPage);
     }
 
     // Then, copy in the code and data segments into memory.
@@ -125,6 +157,11 @@ AddressSpace::AddressSpace(OpenFile *executable_file)
             physicalAddr = AddressTranslation(virtualAddr + i * PAGE_SIZE, pageTable);
             DEBUG('a', "direccion fisica, at 0x%X\n",physicalAddr);
             writtenSize = _min(PAGE_SIZE, codeSize - totalWrittenCode);
+            if (sharedLoaded.Test((virtualAddr + i * PAGE_SIZE) / PAGE_SIZE)) {
+                // Ya está en memoria, compartida
+                totalWrittenCode += writtenSize;
+                continue;
+            }
             DEBUG('a', "Loading 2 ARGS '%d' '%d' '%d'\n",physicalAddr, writtenSize, totalWrittenCode);
             exe->ReadCodeBlock(&mainMemory[physicalAddr], writtenSize, totalWrittenCode);
             totalWrittenCode += writtenSize;
@@ -152,27 +189,347 @@ AddressSpace::AddressSpace(OpenFile *executable_file)
     #endif
 }
 
+/// Make a copy of `parent`, for `Fork`, that shares its frames
+/// copy-on-write; with a TLB, pages not in memory are read from the same
+/// executable as the parent, even if its file is removed meanwhile, or
+/// from swap.
+AddressSpace::AddressSpace(AddressSpace *parent)
+{
+    ASSERT(parent != nullptr);
+
+    exe = nullptr;
+    #ifdef USE_TLB
+    exe = parent->exe->Share();
+    #endif
+    numPages       = parent->numPages;
+    firstZeroPage  = parent->firstZeroPage;
+    firstGuardPage = parent->firstGuardPage;
+    firstStackPage = parent->firstStackPage;
+    initState();
+
+    DEBUG('a', "Forking address space, num pages %u\n", numPages);
+    pageTable.SetSize(numPages);
+    text = parent->text;
+    if (text != nullptr)
+        ASSERT(text->AddSharer(this));
+    copyPagesFrom(parent);
+}
+
+void
+AddressSpace::initState(){
+    // Table <OpenFile*> *filesTable;
+    processOpenFiles = new Table<OpenFile*>;
+    // Console Input y Output
+    processOpenFiles -> Add(nullptr);
+    processOpenFiles -> Add(nullptr);
+
+    asid           = 0;
+    asidGeneration = 0;  // No ASID yet.
+
+    physicalPagesAssigned = 0;
+    residentTarget        = _min(numPages, PFF_MIN_TARGET);
+    lastFaultTicks        = 0;
+    runTicks              = 0;
+    restoredTicks         = stats->userTicks;
+
+    #ifdef USE_TLB
+    tlbLocal = new TranslationEntry[TLB_SIZE];
+    for (unsigned i = 0; i < TLB_SIZE; i++)
+        tlbLocal[i].valid = false;
+    loadedPages = new Bitmap(numPages);
+    faultAroundWindow = faultAroundPages;
+    pagesAhead        = new Bitmap(numPages);
+    lastPageAround    = numPages;  // No page yet.
+    if (loadControl != nullptr)
+        loadControl->Add(this);
+    #endif
+}
+
+AddressSpace *
+AddressSpace::Fork(){
+    if (text != nullptr && text->IsFull())
+        return nullptr;
+
+    return new AddressSpace(this);
+}
+
+void
+AddressSpace::copyPagesFrom(AddressSpace *parent){
+    #ifndef USE_TLB
+    for (unsigned i = 0; i < numPages; i++) {
+        const TranslationEntry *entry = parent->pageTable.Find(i);
+        if (entry == nullptr || !entry->valid)
+            continue;  // Páginas de guarda.
+        pageTable[i] = *entry;
+        if (isSharedPage(i) || isZeroPage(i))
+            continue;
+        // Ninguno de los dos escribe la página sin antes copiarla
+        unsigned frame = parent->pageTable[i].physicalPage;
+        if (!cowMap->IsSharedBy(frame, parent))
+            cowMap->Share(frame, parent);
+        cowMap->Share(frame, this);
+        parent->pageTable[i].readOnly = true;
+        pageTable[i].readOnly         = true;
+        stats->numPagesForked++;
+    }
+    // La MMU recuerda qué páginas se pueden escribir
+    machine->GetMMU()->FlushSoftTlb();
+    #else
+    // Los bits `dirty` de la TLB quedan en la tabla de páginas, y ninguna
+    // entrada permite escribir una página que pasa a ser compartida
+    for (unsigned i = 0; i < numPages; i++) {
+        const TranslationEntry *entry = parent->pageTable.Find(i);
+        if (entry != nullptr && entry->inMemory)
+            parent->demoteRegion(i);
+    }
+    if (parent->asidGeneration == currentAsidGeneration)
+        machine->GetMMU()->InvalidateTlb(parent->asid);
+
+    for (unsigned i = 0; i < numPages; i++) {
+        const TranslationEntry *entry = parent->pageTable.Find(i);
+        if (entry == nullptr || isSharedPage(i))
+            continue;
+        if (parent->isZeroPage(i)) {
+            mapZeroPage(i);
+            continue;
+        }
+        TranslationEntry &mine = pageTable[i];
+        TranslationEntry &theirs = parent->pageTable[i];
+        if (theirs.inSwap) {
+            // Comparten la copia en Swap hasta que uno la vuelve a escribir
+            mine.inSwap   = true;
+            mine.swapSlot = theirs.swapSlot;
+            swapArea->Share(theirs.swapSlot);
+        }
+        if (theirs.inMemory) {
+            // Ninguno de los dos escribe la página sin antes copiarla
+            unsigned frame = theirs.physicalPage;
+            if (!cowMap->IsSharedBy(frame, parent))
+                cowMap->Share(frame, parent);
+            cowMap->Share(frame, this);
+            mine.physicalPage = frame;
+            mine.inMemory     = true;
+            mine.valid        = theirs.valid;
+            mine.dirty        = theirs.dirty;
+            mine.readOnly     = true;
+            theirs.readOnly   = true;
+            stats->numPagesForked++;
+        }
+    }
+    #endif
+}
+
+#ifndef USE_TLB
+/// Without a TLB no page is ever evicted, so a process that needs one more
+/// frame when memory is full is killed, as on a stack overflow.
+static void
+OutOfMemory(unsigned vpn)
+{
+    fprintf(stderr, "Out of memory for page %u, killing the process.\n",
+            vpn);
+    currentThread->Finish(-1);
+}
+#endif
+
+bool
+AddressSpace::CopyOnWrite(unsigned vpn){
+    if (vpn >= numPages || isSharedPage(vpn))
+        return false;
+    const TranslationEntry *entry = pageTable.Find(vpn);
+    if (entry == nullptr || !entry->inMemory || !entry->readOnly)
+        return false;
+    if (isZeroPage(vpn)) {
+        fillZeroPage(vpn);
+        return true;
+    }
+
+    unsigned frame = entry->physicalPage;
+    ASSERT(cowMap->IsSharedBy(frame, this));
+    if (cowMap->CountSharers(frame) > 1) {
+        DEBUG('e', "Copying page %u, shared copy-on-write\n", vpn);
+        #ifndef USE_TLB
+        int copy = mapTable->Find();
+        if (copy == -1)
+            OutOfMemory(vpn);
+        #else
+        unsigned copy = findFrame();
+        if (!pageTable[vpn].inMemory || !pageTable[vpn].readOnly
+              || pageTable[vpn].physicalPage != frame
+              || cowMap->CountSharers(frame) == 1){
+            // Mientras se conseguía el marco, la página salió de memoria o
+            // los demás procesos dejaron de compartirla: se reintenta
+            mapTable->Clear(copy);
+            return true;
+        }
+        #endif
+        char *mainMemory = machine->GetMMU()->mainMemory;
+        memcpy(&mainMemory[copy * PAGE_SIZE], &mainMemory[frame * PAGE_SIZE],
+               PAGE_SIZE);
+        machine->GetMMU()->InvalidateFrame(copy);
+        ASSERT(leaveCowFrame(vpn));
+        pageTable[vpn].physicalPage = copy;
+        #ifdef USE_TLB
+        coreMap->Assign(copy, this, vpn, &pageTable[vpn]);
+        physicalPagesAssigned++;
+        #endif
+        stats->numPagesCopied++;
+    }
+    else {
+        // Ya no la comparte nadie más: alcanza con poder escribirla
+        ASSERT(!leaveCowFrame(vpn));
+    }
+
+    pageTable[vpn].readOnly = false;
+    #ifdef USE_TLB
+    // El acceso se reintenta sin volver a fallar: si la página saliera de
+    // memoria antes, podría no terminar nunca
+    invalidateTlbPage(vpn);
+    loadInTlb(vpn);
+    #else
+    machine->GetMMU()->FlushSoftTlb();
+    #endif
+    return true;
+}
+
+bool
+AddressSpace::IsGuardPage(unsigned vpn) const{
+    return firstGuardPage <= vpn && vpn < firstStackPage;
+}
+
+bool
+AddressSpace::isZeroFillPage(unsigned vpn) const{
+    return vpn >= firstZeroPage && vpn < numPages && !IsGuardPage(vpn);
+}
+
+bool
+AddressSpace::isZeroPage(unsigned vpn) const{
+    const TranslationEntry *entry = pageTable.Find(vpn);
+    return entry != nullptr && entry->inMemory
+        && entry->physicalPage == zeroFrame;
+}
+
+void
+AddressSpace::mapZeroPage(unsigned vpn){
+    DEBUG('e', "Mapping page %u to the zero frame\n", vpn);
+    pageTable[vpn].physicalPage = zeroFrame;
+    pageTable[vpn].inMemory     = true;
+    pageTable[vpn].valid        = true;
+    pageTable[vpn].readOnly     = true;
+    pageTable[vpn].use          = false;
+    pageTable[vpn].dirty        = false;
+    stats->numZeroPagesMapped++;
+}
+
+void
+AddressSpace::fillZeroPage(unsigned vpn){
+    DEBUG('e', "Giving page %u, written for the first time, a frame\n", vpn);
+    #ifndef USE_TLB
+    int frame = mapTable->Find();
+    if (frame == -1)
+        OutOfMemory(vpn);
+    #else
+    unsigned frame = findFrame();
+    if (!isZeroPage(vpn)) {
+        // Mientras se conseguía el marco, la página cambió: se reintenta
+        mapTable->Clear(frame);
+        return;
+    }
+    #endif
+    char *mainMemory = machine->GetMMU()->mainMemory;
+    memset(&mainMemory[frame * PAGE_SIZE], 0, PAGE_SIZE);
+    machine->GetMMU()->InvalidateFrame(frame);
+    pageTable[vpn].physicalPage = frame;
+    pageTable[vpn].readOnly     = false;
+    stats->numZeroPagesFilled++;
+    #ifdef USE_TLB
+    coreMap->Assign(frame, this, vpn, &pageTable[vpn]);
+    loadedPages->Mark(vpn);
+    physicalPagesAssigned++;
+    // Como en `CopyOnWrite`, queda en la TLB
+    invalidateTlbPage(vpn);
+    loadInTlb(vpn);
+    #else
+    machine->GetMMU()->FlushSoftTlb();
+    #endif
+}
+
+bool
+AddressSpace::isCowPage(unsigned vpn) const{
+    const TranslationEntry *entry = pageTable.Find(vpn);
+    return entry != nullptr && entry->inMemory && !isSharedPage(vpn)
+        && cowMap->IsSharedBy(entry->physicalPage, this);
+}
+
+bool
+AddressSpace::leaveCowFrame(unsigned vpn){
+    unsigned frame = pageTable[vpn].physicalPage;
+    if (cowMap->Unshare(frame, this) == 0)
+        return false;
+    #ifdef USE_TLB
+    if (coreMap->GetSpace(frame) == this) {
+        // El marco pasa a ser de otro de los procesos que lo comparten
+        AddressSpace *other = cowMap->GetSharer(frame, 0);
+        coreMap->Release(frame);
+        coreMap->Assign(frame, other, vpn, &other->pageTable[vpn]);
+        physicalPagesAssigned--;
+        other->physicalPagesAssigned++;
+    }
+    #endif
+    return true;
+}
+
 /// Deallocate an address space.
 ///
 // Plancha 3 - Ejercicio 3
 AddressSpace::~AddressSpace()
 {
+    DEBUG('a', "Page table used %u of %u second-level tables\n",
+          pageTable.CountChunks(),
+          DivRoundUp(numPages, PAGE_TABLE_CHUNK));
 
     for (unsigned i = 0; i < numPages; i++)
     {
         // Plancha 4 - Ejercicio 4    
-        // Liberamos las paginas usadas que no estén en Swap
-        if(pageTable[i].valid && pageTable[i].inMemory)
-            mapTable->Clear(pageTable[i].physicalPage);
+        // Liberamos las paginas usadas que no estén en Swap (las cargadas
+        // por adelantado siguen sin ser válidas)
+        // Las compartidas las libera el texto, con el último proceso, o el
+        // último de los que la comparten copy-on-write
+        const TranslationEntry *entry = pageTable.Find(i);
+        if(entry != nullptr && entry->inMemory && !isSharedPage(i)
+             && !isZeroPage(i) && !(isCowPage(i) && leaveCowFrame(i))){
+            mapTable->Clear(entry->physicalPage);
+            #ifdef USE_TLB
+            coreMap->Release(entry->physicalPage);
+            #endif
+        }
+        #ifdef USE_TLB
+        if (entry != nullptr && entry->inSwap)
+            swapArea->Free(entry->swapSlot);
+        #endif
+    }
+    if (text != nullptr)
+        text->Detach(this);
+    if (machine->GetMMU()->refillTable == &pageTable)
+        machine->GetMMU()->refillTable = nullptr;
+    #ifdef USE_TLB
+    coreMap->Forget(this);
+    if (loadControl != nullptr)
+        loadControl->Remove(this);
+    if (asidGeneration == currentAsidGeneration) {
+        // Nothing may be written back to the page table from now on.
+        machine->GetMMU()->InvalidateTlb(asid);
+        machine->GetMMU()->SetAsidTable(asid, nullptr);
     }
-    delete [] pageTable;
+    #endif
+    machine->GetMMU()->FlushSoftTlb();
     // Plancha 4 - Ejercicio 3
     #ifdef USE_TLB
+    delete loadedPages;
+    delete pagesAhead;
     delete [] tlbLocal;
-    ASSERT(fileSystem->Remove(swapName));
-    delete swapFile;
     #endif
-    delete exe;
+    if (exe != nullptr && exe->Unshare())
+        delete exe;
     delete processOpenFiles;
 }
 
@@ -206,34 +563,14 @@ AddressSpace::InitRegisters()
 /// On a context switch, save any machine state, specific to this address
 /// space, that needs saving.
 ///
-/// For now, nothing!
+/// For now, nothing!  Pages stay in memory until some process needs their
+/// frames (see `CoreMap`), and TLB entries are told apart by ASID.
 void
 AddressSpace::SaveState()
 {
     // Plancha 4 - Ejercicio 3
     DEBUG('a', "Saving state..\n");
-    #ifdef USE_TLB
-    // Plancha 4 - Ejercicio 4    
-    // Liberamos la Memoria para el proximo proceso
-    for (unsigned i = 0; i < numPages; i++)
-    {
-        if(pageTable[i].valid && pageTable[i].inMemory)
-        {
-            // Guardamos en Swap las páginas que están en memoria
-            /// TODO: guardar solos las páginas dirty
-            saveInSwap(pageTable[i].virtualPage);
-            pageTable[i].inMemory = false;
-            pageTable[i].inTLB = false;
-            mapTable->Clear(pageTable[i].physicalPage);
-        }
-    }
-
-    for (size_t i = 0; i < TLB_SIZE; i++)
-    {
-        machine->GetMMU()->tlb[i].valid = false;
-    }
-    
-    #endif
+    runTicks += stats->userTicks - restoredTicks;
 }
 
 /// On a context switch, restore the machine state so that this address space
@@ -246,12 +583,59 @@ AddressSpace::RestoreState()
 {
     // Plancha 4 - Ejercicio 3
     DEBUG('a', "Restoring state..\n");
+    restoredTicks = stats->userTicks;
     #ifndef USE_TLB
-        machine->GetMMU()->pageTable     = pageTable;
-        machine->GetMMU()->pageTableSize = numPages;
+        machine->GetMMU()->pageTable = &pageTable;
+        // A new page table may reuse the memory of an old one.
+        machine->GetMMU()->FlushSoftTlb();
+    #else
+        MMU *mmu = machine->GetMMU();
+        if (asidGeneration != currentAsidGeneration) {
+            if (nextAsid == NUM_ASIDS) {
+                // Out of ASIDs: start over, with an empty TLB.
+                DEBUG('a', "ASID rollover\n");
+                mmu->InvalidateTlb();
+                for (unsigned i = 1; i < NUM_ASIDS; i++)
+                    mmu->SetAsidTable(i, nullptr);
+                currentAsidGeneration++;
+                nextAsid = 1;
+            }
+            asid           = nextAsid++;
+            asidGeneration = currentAsidGeneration;
+            mmu->SetAsidTable(asid, &pageTable);
+            DEBUG('a', "Address space gets ASID %u\n", asid);
+        }
+        mmu->currentAsid = asid;
+
+        // For TLB misses on pages in memory, if the MMU refills the TLB.
+        mmu->refillTable = &pageTable;
     #endif
 }
 
+unsigned
+AddressSpace::GetResidentPages() const
+{
+    return physicalPagesAssigned;
+}
+
+unsigned
+AddressSpace::GetResidentTarget() const
+{
+    return residentTarget;
+}
+
+bool
+AddressSpace::IsOverTarget() const
+{
+    return physicalPagesAssigned > residentTarget;
+}
+
+bool
+AddressSpace::isSharedPage(unsigned vpn) const
+{
+    return text != nullptr && text->IsShared(vpn);
+}
+
 // Plancha 4 - Ejercicio 1
 #ifdef USE_TLB
 void
@@ -259,138 +643,556 @@ AddressSpace::LoadPage(unsigned vpn)
 {
     DEBUG('e', "Loading page %d in memory\n",vpn);
 
-    // unsigned victimPage;
-    unsigned victimPageTLB = machine->GetMMU()->getTLBVictimPage();
+    if (pageTable[vpn].inMemory && pagesAhead->Test(vpn))
+        pageAheadUsed(vpn);
+
+    if (! pageTable[vpn].inMemory){
+        stats->numPageLoads++;
+        updateResidentTarget(vpn);
+        // Puede que haya que esperar a que haya memoria para el proceso
+        if (loadControl != nullptr)
+            loadControl->Admit(this);
+        // Si se puede, traemos toda la región de la página como superpágina
+        promoteRegion(vpn);
+    }
+
+    if (! pageTable[vpn].inMemory && ! pageTable[vpn].inSwap
+          && isZeroFillPage(vpn) && ! willLoadAhead(vpn)){
+        // Nunca se escribió, y se carga sola: se lee del marco en cero, sin
+        // ocupar otro
+        mapZeroPage(vpn);
+    }
+
+    if (! pageTable[vpn].inMemory){
+        unsigned pageNumber = findFrame();
+        if (pageTable[vpn].inMemory){
+            // Mientras esperaba el marco, otro proceso cargó la página de
+            // código compartido
+            mapTable->Clear(pageNumber);
+        }
+        else if (isSharedPage(vpn)){
+            loadSharedPage(vpn, pageNumber);
+        }
+        else {
+            // Cargamos la página en Memoria, y las siguientes si hay
+            // marcos libres
+            loadPagesAround(vpn, pageNumber);
+        }
+    }
+    if (pageOutDaemon != nullptr)
+        pageOutDaemon->Check();
+
+    // La víctima de la TLB se elige recién ahora: el desalojo pudo haber
+    // deshecho la superpágina
+    loadInTlb(vpn);
+}
+
+void
+AddressSpace::loadInTlb(unsigned vpn){
+    unsigned shift = pageTable[vpn].pageShift;
+    unsigned victimPageTLB =
+        machine->GetMMU()->getTLBVictimPage(vpn >> shift << shift, shift);
     DEBUG('e', "Indice de la página víctima de la TLB: %d\n", victimPageTLB);
-    
+
+    // load page in TLB
+    pageTable[vpn].valid = true;
+    pageTable[vpn].inTLB = true;
+
+    machine->GetMMU()->tlb[victimPageTLB] = pageTable.Mapping(vpn);
+    machine->GetMMU()->tlb[victimPageTLB].asid = asid;
+    machine->GetMMU()->FlushSoftTlb();
+    DEBUG('e', "Virtual Page %d Loaded Successfully in TLB[%d] "
+          "with PhysicalPage %d\n", vpn, victimPageTLB,
+          machine->GetMMU()->tlb[victimPageTLB].physicalPage);
+}
+
+unsigned
+AddressSpace::findFrame(){
     // Buscamos un lugar para la página en Memoria
     int pageNumber = -1;
-    if (mapTable->CountClear() > 0 && ! pageTable[vpn].inMemory){
-        // Si hay lugar en Memoria y la página no está en ella
+    if (mapTable->CountClear() > 0){
+        // Si hay lugar en Memoria
+        pageNumber = mapTable->Find();
+    }
+    while (pageNumber == -1 && pageOutDaemon != nullptr){
+        // El daemon libera marcos en segundo plano: si no quedó ninguno,
+        // lo esperamos
+        pageOutDaemon->WaitForFrames();
         pageNumber = mapTable->Find();
     }
     if (pageNumber == -1){
-        // La Memoria está llena, saco una página de memoria y la guardo en Swap
-        int pageTableIndex = -1;
-        pageTableIndex = getPageTableVictim(victimPageTLB);
-        ASSERT(pageTableIndex != -1);
-        
-        pageNumber = pageTable[pageTableIndex].physicalPage;
-        saveInSwap(pageTableIndex);
-        pageTable[pageTableIndex].inMemory = false;
+        // La Memoria está llena, saco una página de memoria y la guardo en
+        // Swap: del mismo proceso si ya tiene todos los marcos que le
+        // tocan, si no de cualquiera
+        bool local = physicalPagesAssigned >= residentTarget;
+        pageNumber = coreMap->FindVictim(local ? this : nullptr);
+        AddressSpace *owner = coreMap->GetSpace(pageNumber);
+        owner->evictPage(coreMap->GetVirtualPage(pageNumber));
     }
     ASSERT(pageNumber != -1);
+    return pageNumber;
+}
 
-    // Cargamos la página en Memoria
-    if (! pageTable[vpn].valid){
-        // La página no fue cargada todavía
-        pageTable[vpn].physicalPage = pageNumber;
-        loadPageFromExe(vpn);
-        saveInSwap(vpn);
+void
+AddressSpace::loadSharedPage(unsigned vpn, unsigned frame){
+    DEBUG('e', "Loading shared code page %u in Physical Page %u\n",
+          vpn, frame);
+    char *mainMemory = machine->GetMMU()->mainMemory;
+    readPagesFromExe(&mainMemory[frame * PAGE_SIZE], vpn, 1);
+    machine->GetMMU()->InvalidateFrame(frame);
+    loadedPages->Mark(vpn);
+    // Queda en la tabla de páginas de todos los procesos del texto
+    text->SetFrame(vpn, frame);
+    coreMap->Assign(frame, this, vpn, &pageTable[vpn]);
+}
+
+void
+AddressSpace::mapSharedPage(unsigned vpn, unsigned frame){
+    ASSERT(!pageTable[vpn].inMemory);
+    pageTable[vpn].physicalPage = frame;
+    pageTable[vpn].inMemory     = true;
+    pageTable[vpn].valid        = true;
+    pageTable[vpn].readOnly     = true;
+    pageTable[vpn].use          = false;
+    pageTable[vpn].dirty        = false;
+}
+
+void
+AddressSpace::unmapSharedPage(unsigned vpn){
+    ASSERT(pageTable[vpn].inMemory);
+    invalidateTlbPage(vpn);
+    pageTable[vpn].inMemory = false;
+    pageTable[vpn].inTLB    = false;
+}
+
+void
+AddressSpace::adoptSharedPage(unsigned vpn){
+    ASSERT(pageTable[vpn].inMemory);
+    unsigned frame = pageTable[vpn].physicalPage;
+    coreMap->Release(frame);
+    coreMap->Assign(frame, this, vpn, &pageTable[vpn]);
+}
+
+void
+AddressSpace::loadPageInFrame(unsigned vpn, unsigned physicalPage){
+    loadPagesInFrames(vpn, 1, &physicalPage);
+}
+
+void
+AddressSpace::loadPagesInFrames(unsigned first, unsigned count,
+                                const unsigned *frames){
+    ASSERT(count > 0 && count <= MAX_FAULT_AROUND);
+    char buffer[MAX_FAULT_AROUND * PAGE_SIZE];
+    if (pageTable[first].inSwap){
+        // Las páginas fueron modificadas alguna vez: su copia en Swap está
+        // al día
+        readPagesFromSwap(buffer, first, count);
+    }
+    else {
+        // Las páginas están como en el ejecutable (o en cero, si son de pila)
+        readPagesFromExe(buffer, first, count);
     }
-    else if (! pageTable[vpn].inMemory){
-        // La página ya fue cargada pero está en Swap y no en Memoria
-        loadPageFromSwap(vpn, pageNumber);    
+
+    char *mainMemory = machine->GetMMU()->mainMemory;
+    for (unsigned i = 0; i < count; i++) {
+        unsigned vpn = first + i;
+        DEBUG('e', "Loading Virtual Page %u in Physical Page %u\n",
+              vpn, frames[i]);
+        memcpy(&mainMemory[frames[i] * PAGE_SIZE], &buffer[i * PAGE_SIZE],
+               PAGE_SIZE);
+        pageTable[vpn].physicalPage = frames[i];
+        pageTable[vpn].inMemory = true;
+        machine->GetMMU()->InvalidateFrame(frames[i]);
+        coreMap->Assign(frames[i], this, vpn, &pageTable[vpn]);
+        loadedPages->Mark(vpn);
+        physicalPagesAssigned++;
     }
+}
 
-    // load page in TLB
-    pageTable[vpn].valid = true;
-    pageTable[vpn].inTLB = true;
+void
+AddressSpace::loadPagesAround(unsigned vpn, unsigned physicalPage){
+    // Una falla justo después de la ventana anterior: el proceso recorre
+    // sus páginas en orden
+    if (vpn == lastPageAround + 1 && faultAroundWindow < faultAroundPages)
+        faultAroundWindow++;
+
+    // Solo se usan marcos libres: no se desaloja una página por otra que
+    // quizás no se use.  Con el daemon, tampoco los que él mantiene libres
+    unsigned reserved = pageOutDaemon != nullptr ? PAGE_OUT_LOW : 0;
+    bool inSwap = pageTable[vpn].inSwap;
+    unsigned frames[MAX_FAULT_AROUND];
+    unsigned count = 1;
+    frames[0] = physicalPage;
+    while (count < faultAroundWindow && vpn + count < numPages
+             && mapTable->CountClear() > reserved
+             && canLoadAhead(vpn + count, inSwap))
+        frames[count++] = mapTable->Find();
 
-    machine->GetMMU()->tlb[victimPageTLB] = pageTable[vpn];
-    DEBUG('e', "Virtual Page %d Loaded Successfully in TLB[%d] with PhysicalPage %d\n", vpn, victimPageTLB, machine->GetMMU()->tlb[victimPageTLB].physicalPage);
+    loadPagesInFrames(vpn, count, frames);
+    for (unsigned i = vpn + 1; i < vpn + count; i++) {
+        // Sin validez, el primer uso pasa por `LoadPage` y se nota
+        pageTable[i].valid = false;
+        pageTable[i].use   = false;
+        pagesAhead->Mark(i);
+    }
+    stats->numPagesAhead += count - 1;
+    lastPageAround = vpn + count - 1;
+}
+
+bool
+AddressSpace::willLoadAhead(unsigned vpn){
+    // Uno de los marcos libres es para la página misma
+    unsigned reserved = pageOutDaemon != nullptr ? PAGE_OUT_LOW : 0;
+    return faultAroundWindow > 1 && vpn + 1 < numPages
+        && mapTable->CountClear() > reserved + 1
+        && canLoadAhead(vpn + 1, pageTable[vpn].inSwap);
+}
+
+bool
+AddressSpace::canLoadAhead(unsigned vpn, bool inSwap){
+    if (isSharedPage(vpn) || IsGuardPage(vpn))
+        return false;
+    const TranslationEntry *entry = pageTable.Find(vpn);
+    if (entry == nullptr)
+        return !inSwap;
+    // Las de Swap, solo si se leen con las anteriores, de slots seguidos
+    return !entry->inMemory && entry->inSwap == inSwap
+        && (!inSwap || entry->swapSlot == pageTable[vpn - 1].swapSlot + 1);
 }
 
 void
-AddressSpace::loadPageFromExe(unsigned vpn){
-    unsigned physicalAddr = pageTable[vpn].physicalPage * PAGE_SIZE;
-    char *mainMemory = machine->GetMMU()->mainMemory;   
-    uint32_t codeSize = exe->GetCodeSize();
-    uint32_t initDataSize = exe->GetInitDataSize();
-    uint32_t initDataAddr = exe->GetInitDataAddr();
+AddressSpace::pageAheadUsed(unsigned vpn){
+    DEBUG('e', "Page %u, loaded ahead, used\n", vpn);
+    pagesAhead->Clear(vpn);
+    stats->numPagesAheadUsed++;
+    if (faultAroundWindow < faultAroundPages)
+        faultAroundWindow++;
+}
+
+void
+AddressSpace::pageAheadDropped(unsigned vpn){
+    DEBUG('e', "Page %u, loaded ahead, dropped unused\n", vpn);
+    pagesAhead->Clear(vpn);
+    faultAroundWindow = faultAroundWindow > 1 ? faultAroundWindow / 2 : 1;
+}
+
+/// Bring the aligned region of `1 << superpageShift` pages that `vpn` is
+/// part of into contiguous frames, and mark it as a superpage, so that one
+/// TLB entry maps all of it.
+///
+/// Nothing is done, and false returned, if superpages are off, the region
+/// goes past the end of the address space or into the guard pages, some of
+/// its pages are in memory already, or there are not enough contiguous free
+/// frames.  Pages mapped to the zero frame do not count as in memory: they
+/// are given zeroed frames of the region.
+bool
+AddressSpace::promoteRegion(unsigned vpn){
+    unsigned shift = machine->GetMMU()->superpageShift;
+    if (shift == 0)
+        return false;
+    unsigned count = 1 << shift;
+    unsigned first = vpn >> shift << shift;
+    if (first + count > numPages)
+        return false;
+    // Las páginas en el marco en cero pasan a tener el suyo
+    for (unsigned i = first; i < first + count; i++)
+        if ((pageTable[i].inMemory && !isZeroPage(i)) || isSharedPage(i)
+              || IsGuardPage(i))
+            return false;
+
+    int frame = mapTable->FindAligned(count);
+    if (frame == -1)
+        return false;
+
+    DEBUG('e', "Promoting pages %u to %u to a superpage at physical page %d\n",
+          first, first + count - 1, frame);
+    for (unsigned i = 0; i < count; i++) {
+        if (isZeroPage(first + i)) {
+            invalidateTlbPage(first + i);
+            pageTable[first + i].inMemory = false;
+            pageTable[first + i].readOnly = false;
+        }
+        loadPageInFrame(first + i, frame + i);
+        pageTable[first + i].valid     = true;
+        pageTable[first + i].pageShift = shift;
+    }
+    return true;
+}
 
-    if (vpn * PAGE_SIZE < codeSize){
-        //we are in Code
+/// Break the superpage `vpn` is part of, if any, back into single pages,
+/// which stay in memory; the TLB entry that maps it is dropped.
+void
+AddressSpace::demoteRegion(unsigned vpn){
+    unsigned shift = pageTable[vpn].pageShift;
+    if (shift == 0)
+        return;
+    unsigned first = vpn >> shift << shift;
+
+    DEBUG('e', "Demoting the superpage of pages %u to %u\n",
+          first, first + (1 << shift) - 1);
+    // Writes the `use` and `dirty` bits back to every page.
+    invalidateTlbPage(vpn);
+    for (unsigned i = first; i < first + (1u << shift); i++)
+        pageTable[i].pageShift = 0;
+}
+
+void
+AddressSpace::readPagesFromExe(char *buffer, unsigned first, unsigned count){
+    uint32_t start = first * PAGE_SIZE;
+    uint32_t end   = (first + count) * PAGE_SIZE;
+    memset(buffer, 0, count * PAGE_SIZE);
+
+    // Cada segmento se lee de una vez; lo que ninguno cubre (datos no
+    // inicializados y pila) queda en cero
+    uint32_t codeAddr = exe->GetCodeAddr();
+    uint32_t codeEnd  = codeAddr + exe->GetCodeSize();
+    uint32_t from = start > codeAddr ? start : codeAddr;
+    uint32_t to   = end < codeEnd ? end : codeEnd;
+    if (from < to) {
         DEBUG('a', "Loading Code\n");
-        exe->ReadCodeBlock(&mainMemory[physicalAddr], PAGE_SIZE, vpn*PAGE_SIZE);
+        exe->ReadCodeBlock(&buffer[from - start], to - from, from - codeAddr);
     }
-    else if (vpn * PAGE_SIZE < codeSize + initDataSize){
-        //we are in Data
+
+    uint32_t dataAddr = exe->GetInitDataAddr();
+    uint32_t dataEnd  = dataAddr + exe->GetInitDataSize();
+    from = start > dataAddr ? start : dataAddr;
+    to   = end < dataEnd ? end : dataEnd;
+    if (from < to) {
         DEBUG('a', "Loading Data\n");
-        exe->ReadDataBlock(&mainMemory[physicalAddr], PAGE_SIZE, vpn*PAGE_SIZE - initDataAddr);
+        exe->ReadDataBlock(&buffer[from - start], to - from, from - dataAddr);
     }
-    else {
-        //we are in Stack
-        DEBUG('a', "Loading Stack %d\n", pageTable[vpn].physicalPage);
-        memset(&mainMemory[physicalAddr], 0, PAGE_SIZE);
-    }
-    pageTable[vpn].inMemory = true;
 }
 
 void
-AddressSpace::loadPageFromSwap(unsigned vpn, unsigned physicalPage){
-    DEBUG('e', "Loading Virtual Page '%d' with Physical Page %d (from Swap to Main Memory)\n", vpn, physicalPage);
-    unsigned physicalAddr = physicalPage * PAGE_SIZE;
-    char *mainMemory = machine->GetMMU()->mainMemory;
-    memset(&mainMemory[physicalAddr], 0, PAGE_SIZE);
-    swapFile->ReadAt(&mainMemory[physicalAddr],PAGE_SIZE, vpn*PAGE_SIZE);
-    pageTable[vpn].inMemory = true;
-    pageTable[vpn].physicalPage = physicalPage;
+AddressSpace::readPagesFromSwap(char *buffer, unsigned first, unsigned count){
+    DEBUG('e', "Loading Virtual Pages %u to %u (from Swap to Main Memory)\n",
+          first, first + count - 1);
+    memset(buffer, 0, count * PAGE_SIZE);
+    // Las páginas en slots seguidos se leen de una vez
+    for (unsigned i = 0; i < count; ) {
+        unsigned slot = pageTable[first + i].swapSlot;
+        unsigned run  = 1;
+        while (i + run < count
+                 && pageTable[first + i + run].swapSlot == slot + run)
+            run++;
+        swapArea->ReadPages(&buffer[i * PAGE_SIZE], slot, run);
+        i += run;
+    }
 }
 
 void
 AddressSpace::saveInSwap(unsigned vpn){
-    DEBUG('e', "Saving Virtual Page '%d' with Physical Page %d (from Main Memory to Swap)\n", vpn, pageTable[vpn].physicalPage);
+    DEBUG('e', "Saving Virtual Page '%d' with Physical Page %d "
+          "(from Main Memory to Swap)\n", vpn, pageTable[vpn].physicalPage);
     char *mainMemory = machine->GetMMU()->mainMemory;
     unsigned physicalAddr = pageTable[vpn].physicalPage * PAGE_SIZE;
-    swapFile->WriteAt(&mainMemory[physicalAddr],PAGE_SIZE, vpn*PAGE_SIZE);
+    unsigned slot = takeSwapSlot(vpn);
+    swapArea->WritePages(&mainMemory[physicalAddr], slot, 1);
     pageTable[vpn].dirty = false;
+    pageTable[vpn].inSwap = true;
 }
 
-// Plancha 4 - Ejercicio 5
-unsigned
-AddressSpace::replaceAlgorithm(){
-    // Algoritmo de Segunda oportunidad mejorada
-    DEBUG('e', "Replace Algorithm for PageTable starts\n");
+void
+AddressSpace::saveClusterInSwap(unsigned vpn){
+    ASSERT(pageTable[vpn].inMemory);
+    invalidateTlbPage(vpn);
+    if (!pageTable[vpn].dirty)
+        return;
 
-    for (unsigned i = 0; i <= numPages; i++)
-    {
-        // DEBUG('e', "Buscando Página Victima, vpn %d valid %d inMemory %d inTLb %d\n", i, pageTable[i].valid, pageTable[i].inMemory, pageTable[i].inTLB);
-        if(pageTable[i].valid && pageTable[i].inMemory)
-        {
-            return i;
-        } 
+    // Las páginas sucias vecinas van en la misma escritura.  Sus bits
+    // `dirty` están al día: se acaba de elegir la víctima
+    unsigned first = vpn, last = vpn;
+    while (last - first + 1 < PAGE_OUT_CLUSTER && last + 1 < numPages
+             && isDirtyInMemory(last + 1))
+        last++;
+    while (last - first + 1 < PAGE_OUT_CLUSTER && first > 0
+             && isDirtyInMemory(first - 1))
+        first--;
+
+    DEBUG('e', "Saving Virtual Pages %u to %u in Swap\n", first, last);
+    for (unsigned i = first; i <= last; i++) {
+        // Vuelven a la TLB limpias, en el próximo fallo
+        invalidateTlbPage(i);
+        // Sus copias en Swap ya no sirven: van todas a slots seguidos
+        releaseSwapSlot(i);
+    }
+    unsigned count = last - first + 1;
+    int slot = swapArea->AllocateRun(count);
+    if (slot == -1) {
+        // No hay tantos slots seguidos: se escriben de a una
+        for (unsigned i = first; i <= last; i++)
+            saveInSwap(i);
+        return;
+    }
+
+    char *mainMemory = machine->GetMMU()->mainMemory;
+    char buffer[PAGE_OUT_CLUSTER * PAGE_SIZE];
+    for (unsigned i = first; i <= last; i++) {
+        unsigned physicalAddr = pageTable[i].physicalPage * PAGE_SIZE;
+        memcpy(&buffer[(i - first) * PAGE_SIZE], &mainMemory[physicalAddr],
+               PAGE_SIZE);
+        pageTable[i].dirty    = false;
+        pageTable[i].inSwap   = true;
+        pageTable[i].swapSlot = slot + (i - first);
     }
-    // Si no encuentra una página para reemplazar, levanta un error
-    ASSERT(false);
-    return 0;
+    swapArea->WritePages(buffer, slot, count);
 }
 
 unsigned
-AddressSpace::getPageTableVictim(unsigned victimIndexTLB){
-    // Algoritmo de Segunda oportunidad mejorada
-    DEBUG('e', "Looking for Page to replace and save in Swap\n");
-
-    // Primero tratamos de usar la página que libera la TLB (si está en Memoria)
-    unsigned victimPageTLB = machine->GetMMU()->tlb[victimIndexTLB].virtualPage;
-    if (machine->GetMMU()->tlb[victimIndexTLB].valid){
-        pageTable[victimPageTLB].inTLB = false;
-        DEBUG('e', "Victim page for PageTable (same as for TLB): %d\n",victimPageTLB);
-        return victimPageTLB;
-    }
-
-    // usamos un algoritmo de reemplazo de página para obtener un índice de página válido
-    unsigned victimPage = replaceAlgorithm();
-    // Si la página está en la TLB, invalidamos la entrada 
-    // (CASO TLB con espacio pero Memoria llena)
-    if(pageTable[victimPage].inTLB){
-        for(unsigned j = 0; j <= TLB_SIZE; j++){
-            if(machine->GetMMU()->tlb[j].virtualPage == victimPage)
-                machine->GetMMU()->tlb[j].valid = false;
+AddressSpace::takeSwapSlot(unsigned vpn){
+    TranslationEntry &entry = pageTable[vpn];
+    if (entry.inSwap && !swapArea->IsShared(entry.swapSlot))
+        return entry.swapSlot;
+    // Sin slot, o con uno compartido con otro proceso desde `Fork`
+    releaseSwapSlot(vpn);
+    int slot = swapArea->Allocate();
+    ASSERT(slot != -1);  // Swap lleno.
+    entry.swapSlot = slot;
+    return slot;
+}
+
+void
+AddressSpace::releaseSwapSlot(unsigned vpn){
+    TranslationEntry &entry = pageTable[vpn];
+    if (entry.inSwap)
+        swapArea->Free(entry.swapSlot);
+    entry.inSwap = false;
+}
+
+bool
+AddressSpace::isDirtyInMemory(unsigned vpn){
+    const TranslationEntry *entry = pageTable.Find(vpn);
+    return entry != nullptr && entry->inMemory && entry->dirty;
+}
+
+void
+AddressSpace::cleanPage(unsigned vpn){
+    ASSERT(pageTable[vpn].inMemory);
+    // Escribe en la tabla de páginas el bit `dirty` de la TLB; la página
+    // vuelve a la TLB limpia, en el próximo fallo
+    invalidateTlbPage(vpn);
+    if (pageTable[vpn].dirty)
+        saveInSwap(vpn);
+}
+
+void
+AddressSpace::evictPage(unsigned vpn){
+    DEBUG('e', "Evicting Virtual Page '%u' with Physical Page %u\n",
+          vpn, pageTable[vpn].physicalPage);
+    ASSERT(pageTable[vpn].inMemory);
+
+    if (isSharedPage(vpn)) {
+        // Código compartido, sin cambios: se saca de todos los procesos
+        unsigned frame = pageTable[vpn].physicalPage;
+        text->Evict(vpn);
+        coreMap->Release(frame);
+        stats->numPagesDropped++;
+        return;
+    }
+    if (isCowPage(vpn)) {
+        evictCowPage(vpn);
+        return;
+    }
+
+    // Bajo presión de memoria, las superpáginas vuelven a ser páginas
+    demoteRegion(vpn);
+    // Escribe en la tabla de páginas el bit `dirty` de la TLB
+    invalidateTlbPage(vpn);
+    if (pageTable[vpn].dirty)
+        saveInSwap(vpn);
+    else {
+        // Sin cambios desde que se cargó: se vuelve a leer de donde vino
+        DEBUG('e', "Dropping clean Virtual Page '%u'\n", vpn);
+        stats->numPagesDropped++;
+    }
+    if (pagesAhead->Test(vpn))
+        pageAheadDropped(vpn);
+    pageTable[vpn].inMemory = false;
+    pageTable[vpn].inTLB = false;
+    coreMap->Release(pageTable[vpn].physicalPage);
+    physicalPagesAssigned--;
+}
+
+void
+AddressSpace::evictCowPage(unsigned vpn){
+    // Cada proceso que la comparte la guarda en Swap, si hace falta, y deja
+    // de compartirla: al volver a cargarla, es solo suya
+    unsigned frame = pageTable[vpn].physicalPage;
+    AddressSpace *owner = coreMap->GetSpace(frame);
+    DEBUG('e', "Evicting page %u, shared copy-on-write by %u processes\n",
+          vpn, cowMap->CountSharers(frame));
+    int written = -1;  // Slot de la copia ya escrita.
+    while (cowMap->CountSharers(frame) > 0) {
+        AddressSpace *sharer = cowMap->GetSharer(frame, 0);
+        cowMap->Unshare(frame, sharer);
+        TranslationEntry &entry = sharer->pageTable[vpn];
+        sharer->invalidateTlbPage(vpn);
+        if (entry.dirty && written == -1) {
+            sharer->saveInSwap(vpn);
+            written = entry.swapSlot;
+        }
+        else if (entry.dirty) {
+            // El mismo contenido: comparten el slot
+            sharer->releaseSwapSlot(vpn);
+            swapArea->Share(written);
+            entry.swapSlot = written;
+            entry.inSwap   = true;
+            entry.dirty    = false;
+        }
+        else
+            stats->numPagesDropped++;
+        if (sharer->pagesAhead->Test(vpn))
+            sharer->pageAheadDropped(vpn);
+        entry.inMemory = false;
+        entry.inTLB    = false;
+        entry.readOnly = false;
+    }
+    coreMap->Release(frame);
+    owner->physicalPagesAssigned--;
+}
+
+void
+AddressSpace::swapOut(){
+    DEBUG('e', "Swapping out %u pages\n", physicalPagesAssigned);
+    for (unsigned vpn = 0; vpn < numPages; vpn++) {
+        const TranslationEntry *entry = pageTable.Find(vpn);
+        if (entry != nullptr && entry->inMemory && !isSharedPage(vpn)
+              && !isZeroPage(vpn)) {
+            unsigned frame = entry->physicalPage;
+            evictPage(vpn);
+            mapTable->Clear(frame);
         }
     }
-    DEBUG('e', "Victim page for PageTable: %d\n",victimPage);
-    return victimPage;
+    ASSERT(physicalPagesAssigned == 0);
+}
+
+void
+AddressSpace::updateResidentTarget(unsigned vpn){
+    unsigned long now = runTicks + stats->userTicks - restoredTicks;
+    unsigned long interval = now - lastFaultTicks;
+    lastFaultTicks = now;
+
+    unsigned most  = _min(numPages, NUM_PHYS_PAGES);
+    unsigned least = _min(numPages, PFF_MIN_TARGET);
+    if (interval < PFF_LOWER_TICKS) {
+        // Falla seguido por páginas que ya tuvo: le faltan marcos
+        if (loadedPages->Test(vpn) && residentTarget < most)
+            residentTarget++;
+    } else if (interval >= PFF_UPPER_TICKS) {
+        // Hace rato que no falla: le sobran marcos
+        unsigned fewer = interval / PFF_UPPER_TICKS;
+        residentTarget = residentTarget > least + fewer
+                         ? residentTarget - fewer : least;
+    }
+    DEBUG('e', "Page fault after %lu ticks, resident set target %u\n",
+          interval, residentTarget);
+}
+
+void
+AddressSpace::invalidateTlbPage(unsigned vpn){
+    // Sin un ASID vigente, no hay entradas de este proceso en la TLB
+    if (asidGeneration == currentAsidGeneration)
+        machine->GetMMU()->InvalidateTlbPage(asid, vpn);
 }
 
 #endif
\ No newline at end of file
@@ -15,12 +15,44 @@
 
 
 #include "filesys/file_system.hh"
-#include "machine/translation_entry.hh"
+#include "machine/mmu.hh"
+#include "machine/page_table.hh"
 #include "executable.hh"
+#include "shared_text.hh"
+#include "lib/bitmap.hh"
 #include "lib/table.hh"
 
+#include <limits.h>
 
-const unsigned USER_STACK_SIZE = 1024;  ///< Increase this as necessary!
+
+/// Default size up to which user stacks may grow (see `-ss`).  Stack pages
+/// are only given a frame when first written, so a large limit costs no
+/// memory to programs that do not use it.
+const unsigned USER_STACK_SIZE = 1024;
+
+/// Most pages an address space may have, so that every address in it, up
+/// to the top of the stack, fits in 32 bits.  Stacks may grow to half of
+/// them at most, leaving the rest for the program.
+const unsigned MAX_USER_PAGES  = UINT_MAX / PAGE_SIZE;
+const unsigned MAX_STACK_PAGES = MAX_USER_PAGES / 2;
+
+/// Pages left unmapped between the uninitialized data and the lowest page
+/// the stack may grow to.  A process touching them has overflowed its
+/// stack, and is killed.
+const unsigned STACK_GUARD_PAGES = 4;
+
+/// Page fault frequency.  A process that faults again within
+/// `PFF_LOWER_TICKS` of its own running time, on a page it had in memory
+/// before, gets one more frame in its resident set target; one that runs
+/// for `PFF_UPPER_TICKS` or more without faulting gets one frame less for
+/// each such period, down to `PFF_MIN_TARGET`.  Faults on pages touched for
+/// the first time say nothing about how many frames the process needs.
+const unsigned long PFF_LOWER_TICKS = 1000;
+const unsigned long PFF_UPPER_TICKS = 10000;
+const unsigned PFF_MIN_TARGET = 4;
+
+/// Most pages loaded on a single page fault (see `-fa`).
+const unsigned MAX_FAULT_AROUND = 16;
 
 
 class AddressSpace {
@@ -36,11 +68,33 @@ public:
     /// Parameters:
     /// * `executable_file` is the open file that corresponds to the
     ///   program; it contains the object code to load into memory.
-    AddressSpace(OpenFile *executable_file);
+    /// * `name` is the name of the file, if its code may be shared with
+    ///   other processes running it (see `shared_text.hh`).
+    AddressSpace(OpenFile *executable_file, const char *name = nullptr);
 
     /// De-allocate an address space.
     ~AddressSpace();
 
+    /// Make a copy of the address space, for a process created with
+    /// `Fork`.  No memory is copied: both address spaces share every frame
+    /// read-only, and a page is copied only when either of them first
+    /// writes it (see `CopyOnWrite` and `cow_map.hh`).  Likewise, pages in
+    /// swap stay in the same slots until written to swap again.  Open
+    /// files are not inherited.
+    ///
+    /// Returns null if no more processes may share the code of the
+    /// executable.
+    AddressSpace *Fork();
+
+    /// Give the address space a copy of its own of page `vpn`, because it
+    /// was written while shared copy-on-write, or while mapped to the zero
+    /// frame.  Returns false if the page is not shared that way, and so may
+    /// not be written at all.
+    bool CopyOnWrite(unsigned vpn);
+
+    /// Return whether page `vpn` is in the guard region below the stack.
+    bool IsGuardPage(unsigned vpn) const;
+
     /// Initialize user-level CPU registers, before jumping to user code.
     void InitRegisters();
 
@@ -53,20 +107,71 @@ public:
     // Plancha 4 - Ejercicio 4
     void saveInSwap(unsigned vpn);
 
-    void loadPageFromExe(unsigned vpn);
+    /// Load page `vpn`, from the executable or from swap, into
+    /// `physicalPage`.
+    void loadPageInFrame(unsigned vpn, unsigned physicalPage);
+
+    /// Load pages `first` to `first + count - 1`, all of them from the
+    /// executable or all from swap, into `frames`, reading each segment
+    /// they cover at once.
+    void loadPagesInFrames(unsigned first, unsigned count,
+                           const unsigned *frames);
+
+    /// Fault-around: load page `vpn` into `physicalPage`, and, into free
+    /// frames, as many of the pages after it as the window allows.
+    void loadPagesAround(unsigned vpn, unsigned physicalPage);
+
+    /// Superpages: see `MMU::superpageShift`.
+    bool promoteRegion(unsigned vpn);
+    void demoteRegion(unsigned vpn);
 
-    void loadPageFromSwap(unsigned vpn, unsigned physicalPage);
+    /// Read pages `first` to `first + count - 1` as in the executable
+    /// (zero, past the initialized data) or from swap, into `buffer`.
+    void readPagesFromExe(char *buffer, unsigned first, unsigned count);
+    void readPagesFromSwap(char *buffer, unsigned first, unsigned count);
 
-    unsigned getPageTableVictim(unsigned victimIndexTLB);
+    /// Take page `vpn` out of memory, to swap.  The frame stays marked as
+    /// in use in `mapTable`, for the caller to reuse.
+    void evictPage(unsigned vpn);
 
-    unsigned replaceAlgorithm();
+    /// Write back and drop the TLB entries of page `vpn`.
+    void invalidateTlbPage(unsigned vpn);
+
+    /// Write page `vpn`, which stays in memory, to swap if it is dirty.
+    void cleanPage(unsigned vpn);
+
+    /// Like `cleanPage`, but write the dirty pages in memory around `vpn`
+    /// as well, with a single swap write of at most `PAGE_OUT_CLUSTER`
+    /// pages (see `vmem/page_out_daemon.hh`).
+    void saveClusterInSwap(unsigned vpn);
+
+    /// Shared code pages (see `shared_text.hh`): map page `vpn`, in
+    /// `frame`, read-only; unmap it; and take the frame over in the core
+    /// map.
+    void mapSharedPage(unsigned vpn, unsigned frame);
+    void unmapSharedPage(unsigned vpn);
+    void adoptSharedPage(unsigned vpn);
+
+    /// Take every page out of memory, freeing its frames; for load control
+    /// (see `vmem/load_control.hh`).  Shared code pages, and those mapped to
+    /// the zero frame, stay.
+    void swapOut();
+
+    /// Resident set: how many pages are in memory, and how many frames the
+    /// process should have, judging by its page fault frequency.  When
+    /// memory is full, a process at its target replaces its own pages, and
+    /// one below it takes frames from those over theirs.  Shared code pages
+    /// count for no process.
+    unsigned GetResidentPages() const;
+    unsigned GetResidentTarget() const;
+    bool IsOverTarget() const;
 
     Table <OpenFile*> *processOpenFiles;
 
 private:
 
-    /// Assume linear page table translation for now!
-    TranslationEntry *pageTable;
+    /// Two-level page table, see `machine/page_table.hh`.
+    PageTable pageTable;
 
     /// Number of pages in the virtual address space.
     unsigned numPages;
@@ -76,11 +181,113 @@ private:
     // Plancha 4 - Ejercicio 3
     TranslationEntry *tlbLocal;
     // Plancha 4 - Ejercicio 4
-    OpenFile *swapFile;
-    // Plancha 4 - Ejercicio 4
-    char swapName[60];
-    // Plancha 4 - Ejercicio 4
     unsigned physicalPagesAssigned;
+
+    /// Code pages shared with other processes running the same file, or
+    /// null.
+    SharedText *text;
+
+    /// Copy `parent`, for `Fork`.
+    AddressSpace(AddressSpace *parent);
+
+    /// Set up everything but the page table and the executable.
+    void initState();
+
+    /// Share every page of `parent` copy-on-write, and its swap slots.
+    void copyPagesFrom(AddressSpace *parent);
+
+    /// Return whether page `vpn` is in a frame shared copy-on-write.
+    bool isCowPage(unsigned vpn) const;
+
+    /// Stop sharing the frame of page `vpn` copy-on-write.  Returns false
+    /// if no other address space shares it any more.
+    bool leaveCowFrame(unsigned vpn);
+
+    /// Take page `vpn`, shared copy-on-write, out of every address space
+    /// that shares it.
+    void evictCowPage(unsigned vpn);
+
+    /// Return whether page `vpn` is one of the shared code pages.
+    bool isSharedPage(unsigned vpn) const;
+
+    /// Layout past the initialized data: uninitialized data from
+    /// `firstZeroPage`, guard pages from `firstGuardPage`, and the stack
+    /// from `firstStackPage` to the end.
+    unsigned firstZeroPage;
+    unsigned firstGuardPage;
+    unsigned firstStackPage;
+
+    /// Return whether page `vpn` starts out all zeros, being uninitialized
+    /// data or stack.
+    bool isZeroFillPage(unsigned vpn) const;
+
+    /// Return whether page `vpn` is mapped to the zero frame.
+    bool isZeroPage(unsigned vpn) const;
+
+    /// Map page `vpn`, never written, read-only to the zero frame.
+    void mapZeroPage(unsigned vpn);
+
+    /// Give page `vpn`, mapped to the zero frame, a zeroed frame of its
+    /// own, because it is being written.
+    void fillZeroPage(unsigned vpn);
+
+    /// Find a frame for a page: a free one, or one taken from some page.
+    unsigned findFrame();
+
+    /// Put the translation of page `vpn`, which is in memory, in the TLB.
+    void loadInTlb(unsigned vpn);
+
+    /// Load shared code page `vpn` into `frame`, for every process of the
+    /// text.
+    void loadSharedPage(unsigned vpn, unsigned frame);
+
+    /// Return a slot of the swap area to write page `vpn` to: the one it
+    /// has, unless it shares it, or a new one.
+    unsigned takeSwapSlot(unsigned vpn);
+
+    /// Give up the slot of page `vpn`, if it has one.
+    void releaseSwapSlot(unsigned vpn);
+
+    /// Return whether page `vpn` is in memory and dirty.
+    bool isDirtyInMemory(unsigned vpn);
+
+    /// Return whether page `vpn` may be loaded ahead along with a page that
+    /// is in swap or not, as `inSwap` says.
+    bool canLoadAhead(unsigned vpn, bool inSwap);
+
+    /// Return whether a page fault on `vpn` would load pages after it as
+    /// well, so that `vpn` is better given a frame than the zero frame.
+    bool willLoadAhead(unsigned vpn);
+
+    /// Adjust `faultAroundWindow` on a use, or a drop, of a page loaded
+    /// ahead.
+    void pageAheadUsed(unsigned vpn);
+    void pageAheadDropped(unsigned vpn);
+
+    /// Fault-around window: how many pages are loaded on the next page
+    /// fault.  It starts at `faultAroundPages`, grows by one whenever a
+    /// page loaded ahead is used or the faults go in order, and halves
+    /// whenever one is taken out of memory unused.
+    unsigned faultAroundWindow;
+    Bitmap *pagesAhead;      ///< Pages loaded ahead and not used yet.
+    unsigned lastPageAround;  ///< Last page loaded on the last fault.
+
+    /// Adjust `residentTarget` on a page fault on `vpn`.
+    void updateResidentTarget(unsigned vpn);
+
+    unsigned residentTarget;
+    Bitmap *loadedPages;           ///< Pages that were ever in memory.
+    unsigned long lastFaultTicks;  ///< Running time at the last fault.
+
+    /// Running time, in user ticks: accumulated until the last switch, and
+    /// user ticks of the machine when restored.
+    unsigned long runTicks;
+    unsigned long restoredTicks;
+
+    /// Address space identifier, valid while `asidGeneration` is the
+    /// current generation (see `address_space.cc`).
+    unsigned asid;
+    unsigned asidGeneration;
 };
 
 
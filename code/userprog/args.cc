@@ -5,6 +5,7 @@
 
 #include "transfer.hh"
 #include "machine/machine.hh"
+#include "machine/endianness.hh"
 #include "threads/system.hh"
 
 #include <string.h>
@@ -13,29 +14,36 @@
 static const unsigned MAX_ARG_COUNT  = 32;
 static const unsigned MAX_ARG_LENGTH = 128;
 
-/// Count the number of arguments up to a null (which is not counted).
+/// Read the arguments, up to a null (which is not counted), into `argv`.
 ///
 /// Returns true if the number fit in the established limits and false if
 /// too many arguments were provided.
 static inline
-bool CountArgsToSave(int address, unsigned *count)
+bool ReadArgsToSave(int address, int *argv, unsigned *count)
 {
     ASSERT(address != 0);
+    ASSERT(argv != nullptr);
     ASSERT(count != nullptr);
 
-    int val;
+    // Read the vector a page at a time: it ends at the first null word.
     unsigned c = 0;
     do {
-        machine->ReadMem(address + 4 * c, 4, &val);
-        c++;
-    } while (c < MAX_ARG_COUNT && val != 0);
-    if (c == MAX_ARG_COUNT && val != 0)
-        // The maximum number of arguments was reached but the last is not
-        // null.
-        return false;
-
-    *count = c - 1;
-    return true;
+        unsigned words = (PAGE_SIZE - (address + 4 * c) % PAGE_SIZE) / 4;
+        if (words > MAX_ARG_COUNT - c)
+            words = MAX_ARG_COUNT - c;
+        machine->ReadBlock(address + 4 * c, (char *) &argv[c], 4 * words);
+        for (unsigned end = c + words; c < end; c++) {
+            argv[c] = WordToHost(argv[c]);
+            if (argv[c] == 0) {
+                *count = c;
+                return true;
+            }
+        }
+    } while (c < MAX_ARG_COUNT);
+
+    // The maximum number of arguments was reached but the last is not
+    // null.
+    return false;
 }
 
 char **
@@ -43,8 +51,9 @@ SaveArgs(int address)
 {
     ASSERT(address != 0);
 
+    int argv[MAX_ARG_COUNT];
     unsigned count;
-    if (!CountArgsToSave(address, &count))
+    if (!ReadArgsToSave(address, argv, &count))
         return nullptr;
 
     DEBUG('e', "Saving %u command line arguments from parent process.\n",
@@ -56,10 +65,8 @@ SaveArgs(int address)
 
     for (unsigned i = 0; i < count; i++) {
         args[i] = new char [MAX_ARG_LENGTH];
-        int strAddr;
         // For each pointer, read the corresponding string.
-        machine->ReadMem(address + i * 4, 4, &strAddr);
-        ReadStringFromUser(strAddr, args[i], MAX_ARG_LENGTH);
+        ReadStringFromUser(argv[i], args[i], MAX_ARG_LENGTH);
     }
     args[count] = nullptr;  // Write the trailing null.
 
@@ -92,10 +99,11 @@ WriteArgs(char **args)
 
     sp -= sp % 4;     // Align the stack to a multiple of four.
     sp -= c * 4 + 4;  // Make room for `argv`, including the trailing null.
-    // Write each argument's address.
+    // Write each argument's address, and the last null, all at once.
     for (unsigned i = 0; i < c; i++)
-        machine->WriteMem(sp + 4 * i, 4, argsAddress[i]);
-    machine->WriteMem(sp + 4 * c, 4, 0);  // The last is null.
+        argsAddress[i] = WordToMachine(argsAddress[i]);
+    argsAddress[c] = 0;
+    machine->WriteBlock(sp, (const char *) argsAddress, 4 * c + 4);
 
     machine->WriteRegister(STACK_REG, sp);
     return c;
@@ -0,0 +1,92 @@
+/// Copyright (c) 2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "cow_map.hh"
+#include "lib/assert.hh"
+
+
+CowMap::CowMap(unsigned size)
+{
+    ASSERT(size > 0);
+
+    numFrames = size;
+    sharers   = new Sharer * [numFrames];
+    for (unsigned i = 0; i < numFrames; i++)
+        sharers[i] = nullptr;
+}
+
+CowMap::~CowMap()
+{
+    for (unsigned i = 0; i < numFrames; i++)
+        while (sharers[i] != nullptr) {
+            Sharer *s = sharers[i];
+            sharers[i] = s->next;
+            delete s;
+        }
+    delete [] sharers;
+}
+
+void
+CowMap::Share(unsigned frame, AddressSpace *space)
+{
+    ASSERT(frame < numFrames);
+    ASSERT(space != nullptr);
+    ASSERT(!IsSharedBy(frame, space));
+
+    Sharer *s = new Sharer;
+    s->space = space;
+    s->next  = sharers[frame];
+    sharers[frame] = s;
+}
+
+unsigned
+CowMap::Unshare(unsigned frame, AddressSpace *space)
+{
+    ASSERT(frame < numFrames);
+
+    for (Sharer **p = &sharers[frame]; *p != nullptr; p = &(*p)->next)
+        if ((*p)->space == space) {
+            Sharer *s = *p;
+            *p = s->next;
+            delete s;
+            return CountSharers(frame);
+        }
+    ASSERT(false);
+    return 0;
+}
+
+unsigned
+CowMap::CountSharers(unsigned frame) const
+{
+    ASSERT(frame < numFrames);
+
+    unsigned count = 0;
+    for (Sharer *s = sharers[frame]; s != nullptr; s = s->next)
+        count++;
+    return count;
+}
+
+AddressSpace *
+CowMap::GetSharer(unsigned frame, unsigned i) const
+{
+    ASSERT(frame < numFrames);
+
+    Sharer *s = sharers[frame];
+    for (; s != nullptr && i > 0; i--)
+        s = s->next;
+    ASSERT(s != nullptr);
+    return s->space;
+}
+
+bool
+CowMap::IsSharedBy(unsigned frame, const AddressSpace *space) const
+{
+    ASSERT(frame < numFrames);
+
+    for (Sharer *s = sharers[frame]; s != nullptr; s = s->next)
+        if (s->space == space)
+            return true;
+    return false;
+}
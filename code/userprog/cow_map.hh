@@ -0,0 +1,57 @@
+/// Frames shared copy-on-write by processes created with `Fork`.
+///
+/// A forked process starts out with the memory of its parent: both map the
+/// same frames, read-only, and the first of them to write a page raises
+/// `READ_ONLY_EXCEPTION` and gets a copy of its own (see
+/// `AddressSpace::CopyOnWrite`).  Forked processes keep their pages at the
+/// same virtual addresses, so a frame is shared at a single virtual page;
+/// the COW map records, for each frame, which address spaces map it that
+/// way.
+///
+/// Copyright (c) 2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_USERPROG_COWMAP__HH
+#define NACHOS_USERPROG_COWMAP__HH
+
+
+class AddressSpace;
+
+class CowMap {
+public:
+
+    /// Create a COW map for `size` physical pages, none of them shared.
+    CowMap(unsigned size);
+
+    ~CowMap();
+
+    /// Record that `space` maps `frame` copy-on-write.
+    void Share(unsigned frame, AddressSpace *space);
+
+    /// Record that `space` no longer maps `frame`.  Returns how many
+    /// address spaces still do.
+    unsigned Unshare(unsigned frame, AddressSpace *space);
+
+    /// Return how many address spaces map `frame` copy-on-write, and the
+    /// `i`-th of them.
+    unsigned CountSharers(unsigned frame) const;
+    AddressSpace *GetSharer(unsigned frame, unsigned i) const;
+
+    /// Return whether `space` maps `frame` copy-on-write.
+    bool IsSharedBy(unsigned frame, const AddressSpace *space) const;
+
+private:
+
+    struct Sharer {
+        AddressSpace *space;
+        Sharer *next;
+    };
+
+    /// For each frame, the address spaces that share it.
+    Sharer **sharers;
+    unsigned numFrames;
+};
+
+
+#endif
@@ -242,6 +242,7 @@ CommandSetFlags(char **args, void *extra)
     }
 
     debug.SetFlags(flags);
+    machine->GetMMU()->FlushSoftTlb();  // So that tracing sees every access.
     if (flags[0] == '\0')
         printf("Debug flags set to empty.\n");
     else
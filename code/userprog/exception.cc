@@ -82,6 +82,29 @@ IncrementPC()
     machine->WriteRegister(NEXT_PC_REG, pc);
 }
 
+/// Run a process created with `Fork`, from the instruction after the system
+/// call, with `Fork` returning 0.
+///
+/// * `registers_` holds the user registers of the parent at the system
+///   call.  They cannot be kept in the thread: if it is preempted before
+///   getting here, the scheduler saves the registers of whatever ran last
+///   there.
+static void
+StartForkedProcess(void *registers_)
+{
+    int *registers = (int *) registers_;
+    for (unsigned i = 0; i < NUM_TOTAL_REGS; i++)
+        machine->WriteRegister(i, registers[i]);
+    delete [] registers;
+    currentThread->space->RestoreState();
+
+    machine->WriteRegister(2, 0);
+    IncrementPC();
+
+    machine->Run();
+    ASSERT(false);
+}
+
 /// Do some default behavior for an unexpected exception.
 ///
 /// NOTE: this function is meant specifically for unexpected exceptions.  If
@@ -172,7 +195,7 @@ SyscallHandler(ExceptionType _et)
             }
 
             // create address space
-            AddressSpace *space = new AddressSpace(executable);
+            AddressSpace *space = new AddressSpace(executable, filename);
             // Plancha 4 - Ejercicio 3
             #ifndef USE_TLB
                 delete executable;
@@ -193,6 +216,30 @@ SyscallHandler(ExceptionType _et)
             break;
         }
 
+        case SC_FORK: {
+            // El hijo comparte la memoria del padre hasta que uno la escribe
+            AddressSpace *space = currentThread->space->Fork();
+            if (space == nullptr) {
+                DEBUG('e', "Error: unable to fork the address space.\n");
+                machine->WriteRegister(2, -1);
+                break;
+            }
+
+            // Sigue desde el mismo punto que el padre
+            int *registers = new int [NUM_TOTAL_REGS];
+            for (unsigned r = 0; r < NUM_TOTAL_REGS; r++)
+                registers[r] = machine->ReadRegister(r);
+
+            Thread *childThread = new Thread("forked", true);
+            childThread->space = space;
+            childThread->Fork(StartForkedProcess, (void *) registers);
+            SpaceId id = userProgTable->Add(childThread);
+            DEBUG('e', "SC_FORK has finished, child %d.\n", id);
+
+            machine->WriteRegister(2, id);
+            break;
+        }
+
         // Plancha 3 - Ejercicio 2
         case SC_JOIN: {
             SpaceId id = machine -> ReadRegister(4);
@@ -220,6 +267,8 @@ SyscallHandler(ExceptionType _et)
 
             // Plancha 3 - Ejercicio 2
             DEBUG('e', "`Create` requested for file `%s`.\n", filename);
+            // Quien ejecute el archivo nuevo no usa el código del viejo
+            SharedText::Forget(filename);
             int success;
             success = fileSystem->Create(filename,INIT_FILE_SIZE, false);
             if(!success){
@@ -242,6 +291,7 @@ SyscallHandler(ExceptionType _et)
                 DEBUG('e', "Error: filename string too long (maximum is %u bytes).\n",
                       FILE_NAME_MAX_LEN);
 
+            SharedText::Forget(filename);
             fileSystem -> Remove(filename);
             DEBUG('e',"%s removed\n",filename);
 
@@ -382,6 +432,12 @@ PageFaultHandler(ExceptionType _et)
     unsigned page = DivRoundDown(Addr, PAGE_SIZE);
     
     DEBUG('e', "Page Fault Exception with page '%d'.\n", page);
+    if (currentThread->space->IsGuardPage(page)) {
+        // La pila creció más allá de su límite (ver `-ss`)
+        fprintf(stderr, "Stack overflow at address %u, killing the process.\n",
+                Addr);
+        currentThread->Finish(-1);
+    }
     #ifdef USE_TLB
         currentThread -> space -> LoadPage(page);
         DEBUG('e', "Page '%d' loaded in TLB.\n", page);
@@ -395,6 +451,9 @@ ReadOnlyHandler(ExceptionType _et)
     unsigned page = DivRoundDown(Addr, PAGE_SIZE);
 
     DEBUG('e', "Read Only Exception for page '%d'.\n", page);
+    // Página compartida copy-on-write: se copia y se reintenta el acceso
+    if (currentThread->space->CopyOnWrite(page))
+        return;
     ASSERT(false);
 }
 
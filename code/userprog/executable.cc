@@ -32,10 +32,25 @@ Executable::Executable(OpenFile *new_file)
 {
     ASSERT(new_file != nullptr);
 
-    file = new_file;
+    file    = new_file;
+    sharers = 1;
     file->ReadAt((char *) &header, sizeof header, 0);
 }
 
+Executable *
+Executable::Share()
+{
+    sharers++;
+    return this;
+}
+
+bool
+Executable::Unshare()
+{
+    ASSERT(sharers > 0);
+    return --sharers == 0;
+}
+
 bool
 Executable::CheckMagic()
 {
@@ -82,6 +97,12 @@ Executable::GetInitDataAddr() const
     return header.initData.virtualAddr;
 }
 
+uint32_t
+Executable::GetUninitDataAddr() const
+{
+    return header.uninitData.virtualAddr;
+}
+
 int
 Executable::ReadCodeBlock(char *dest, uint32_t size, uint32_t offset)
 {
@@ -25,6 +25,14 @@ class Executable {
 public:
     Executable(OpenFile *new_file);
 
+    /// Count one more address space that reads from the executable, as
+    /// processes created with `Fork` do, and return it.
+    Executable *Share();
+
+    /// Stop reading from the executable.  Returns true if no address space
+    /// reads from it any more, so that it may be deleted.
+    bool Unshare();
+
     /// Check if the executable is valid and fix endianness if necessary.
     ///
     /// Check if the executable conforms to the NOFF file format by checking
@@ -65,6 +73,9 @@ public:
 private:
     OpenFile *file;
     noffHeader header;
+
+    /// Number of address spaces reading from the executable.
+    unsigned sharers;
 };
 
 
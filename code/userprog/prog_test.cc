@@ -33,8 +33,10 @@ StartProcess(const char *filename)
         return;
     }
 
-    AddressSpace *space = new AddressSpace(executable);
+    AddressSpace *space = new AddressSpace(executable, filename);
     currentThread->space = space;
+    // El primer proceso es el 0: `Fork` devuelve 0 solo en el hijo
+    userProgTable->Add(currentThread);
 
     // Plancha 4 - Ejercicio 3
     #ifndef USE_TLB
@@ -0,0 +1,198 @@
+/// Copyright (c) 2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "shared_text.hh"
+#include "address_space.hh"
+#include "threads/system.hh"
+
+#include <string.h>
+
+
+/// Texts new processes may attach to.
+static Table<SharedText*> texts;
+
+SharedText *
+SharedText::Attach(const char *name, Executable *exe, AddressSpace *space)
+{
+    ASSERT(name != nullptr);
+    ASSERT(exe != nullptr);
+    ASSERT(space != nullptr);
+
+    SharedText *text = nullptr;
+    for (unsigned i = 0; i < Table<SharedText*>::SIZE; i++)
+        if (texts.HasKey(i) && !strcmp(texts.Get(i)->name, name))
+            text = texts.Get(i);
+    if (text != nullptr && text->codeSize != exe->GetCodeSize()) {
+        // Another file under the same name.
+        Forget(name);
+        text = nullptr;
+    }
+
+    bool created = text == nullptr;
+    if (created) {
+        text = new SharedText(name, exe);
+        if (text->numPages == 0 || texts.Add(text) == -1) {
+            delete text;
+            return nullptr;
+        }
+    }
+    if (!text->AddSharer(space)) {
+        ASSERT(!created);
+        return nullptr;
+    }
+    return text;
+}
+
+bool
+SharedText::AddSharer(AddressSpace *space)
+{
+    ASSERT(space != nullptr);
+
+    if (sharers.Add(space) == -1)
+        return false;
+
+    DEBUG('a', "Process shares %u code pages of `%s`\n", numPages, name);
+    for (unsigned i = 0; i < numPages; i++) {
+        if (frames[i] == -1)
+            continue;
+        stats->numSharedPages++;
+#ifdef USE_TLB
+        space->mapSharedPage(firstPage + i, frames[i]);
+#endif
+    }
+    return true;
+}
+
+bool
+SharedText::IsFull() const
+{
+    for (unsigned i = 0; i < Table<AddressSpace*>::SIZE; i++)
+        if (!sharers.HasKey(i))
+            return false;
+    return true;
+}
+
+void
+SharedText::Forget(const char *name)
+{
+    ASSERT(name != nullptr);
+
+    for (unsigned i = 0; i < Table<SharedText*>::SIZE; i++)
+        if (texts.HasKey(i) && !strcmp(texts.Get(i)->name, name)) {
+            texts.Remove(i);
+            DEBUG('a', "Text of `%s` no longer shared with new processes\n",
+                  name);
+        }
+}
+
+SharedText::SharedText(const char *name_, Executable *exe)
+{
+    name = new char [strlen(name_) + 1];
+    strcpy(name, name_);
+    codeSize = exe->GetCodeSize();
+
+    // Only pages made entirely of code.
+    uint32_t codeAddr = exe->GetCodeAddr();
+    firstPage = DivRoundUp(codeAddr, PAGE_SIZE);
+    unsigned endPage = (codeAddr + codeSize) / PAGE_SIZE;
+    numPages = endPage > firstPage ? endPage - firstPage : 0;
+
+    frames = new int [numPages];
+    for (unsigned i = 0; i < numPages; i++)
+        frames[i] = -1;
+}
+
+SharedText::~SharedText()
+{
+    delete [] name;
+    delete [] frames;
+}
+
+void
+SharedText::Detach(AddressSpace *space)
+{
+    ASSERT(space != nullptr);
+
+    for (unsigned i = 0; i < Table<AddressSpace*>::SIZE; i++)
+        if (sharers.HasKey(i) && sharers.Get(i) == space)
+            sharers.Remove(i);
+
+    AddressSpace *other = nullptr;
+    for (unsigned i = 0; i < Table<AddressSpace*>::SIZE && other == nullptr;
+         i++)
+        if (sharers.HasKey(i))
+            other = sharers.Get(i);
+
+    for (unsigned i = 0; i < numPages; i++) {
+        if (frames[i] == -1)
+            continue;
+#ifdef USE_TLB
+        if (coreMap->GetSpace(frames[i]) != space)
+            continue;
+        if (other != nullptr) {
+            // The core map may not point into a page table that goes away.
+            other->adoptSharedPage(firstPage + i);
+            continue;
+        }
+        coreMap->Release(frames[i]);
+#endif
+        if (other == nullptr)
+            mapTable->Clear(frames[i]);
+    }
+
+    if (other == nullptr) {
+        DEBUG('a', "Last process of `%s` gone, freeing its text\n", name);
+        for (unsigned i = 0; i < Table<SharedText*>::SIZE; i++)
+            if (texts.HasKey(i) && texts.Get(i) == this)
+                texts.Remove(i);
+        delete this;
+    }
+}
+
+bool
+SharedText::IsShared(unsigned vpn) const
+{
+    return firstPage <= vpn && vpn < firstPage + numPages;
+}
+
+int
+SharedText::GetFrame(unsigned vpn) const
+{
+    ASSERT(IsShared(vpn));
+    return frames[vpn - firstPage];
+}
+
+void
+SharedText::SetFrame(unsigned vpn, unsigned frame)
+{
+    ASSERT(IsShared(vpn));
+    ASSERT(frames[vpn - firstPage] == -1);
+
+    frames[vpn - firstPage] = frame;
+#ifdef USE_TLB
+    unsigned count = 0;
+    for (unsigned i = 0; i < Table<AddressSpace*>::SIZE; i++)
+        if (sharers.HasKey(i)) {
+            sharers.Get(i)->mapSharedPage(vpn, frame);
+            count++;
+        }
+    // Every process but the one that loaded it.
+    stats->numSharedPages += count - 1;
+#endif
+}
+
+#ifdef USE_TLB
+void
+SharedText::Evict(unsigned vpn)
+{
+    ASSERT(IsShared(vpn));
+    ASSERT(frames[vpn - firstPage] != -1);
+
+    frames[vpn - firstPage] = -1;
+    for (unsigned i = 0; i < Table<AddressSpace*>::SIZE; i++)
+        if (sharers.HasKey(i))
+            sharers.Get(i)->unmapSharedPage(vpn);
+}
+#endif
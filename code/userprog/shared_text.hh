@@ -0,0 +1,97 @@
+/// Code pages shared by every process running the same executable.
+///
+/// The pages of an executable that hold only code are never written, so
+/// processes running the same file need a single copy of them in memory.
+/// The text of an executable keeps the frame of each of those pages, and
+/// is shared by every address space of the file: the pages are mapped
+/// read-only in all of them (writing raises `READ_ONLY_EXCEPTION`), and
+/// are loaded only by the first process that needs them.  A page that
+/// also holds some data is private to each process, as any other.
+///
+/// With a TLB, shared pages are loaded on demand and may be taken out of
+/// memory like any other page: they are mapped in, or out of, every
+/// address space of the text at once.  Their frames count against no
+/// resident set, and the core map gives each of them to one of the
+/// processes sharing it.
+///
+/// Executables are told apart by file name.  Once a file is removed or
+/// created again, processes started from it get a text of their own.
+///
+/// Copyright (c) 2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_USERPROG_SHAREDTEXT__HH
+#define NACHOS_USERPROG_SHAREDTEXT__HH
+
+
+#include "executable.hh"
+#include "lib/table.hh"
+
+
+class AddressSpace;
+
+class SharedText {
+public:
+
+    /// Return the text of the executable `name`, loaded as `exe` says,
+    /// adding `space` to the address spaces that share it.
+    ///
+    /// Returns null if the text cannot be shared, because it holds no
+    /// whole page of code or too many processes share it.
+    static SharedText *Attach(const char *name, Executable *exe,
+                              AddressSpace *space);
+
+    /// Stop giving out the text of `name` to new processes, because the
+    /// file changed.  Processes running it keep it.
+    static void Forget(const char *name);
+
+    /// Add `space`, a copy of one that shares the text (see
+    /// `AddressSpace::Fork`), to those that share it.  Returns false if
+    /// the text is full; see `IsFull`.
+    bool AddSharer(AddressSpace *space);
+
+    /// Return whether no more address spaces may share the text.
+    bool IsFull() const;
+
+    /// Remove `space` from the address spaces that share the text.  The
+    /// last one to leave frees its frames, and the text itself.
+    void Detach(AddressSpace *space);
+
+    /// Return whether virtual page `vpn` belongs to the text.
+    bool IsShared(unsigned vpn) const;
+
+    /// Return the frame holding page `vpn`, or -1 if it is not in memory.
+    int GetFrame(unsigned vpn) const;
+
+    /// Record that page `vpn` is now in `frame`.  With a TLB, it is mapped
+    /// in every address space of the text.
+    void SetFrame(unsigned vpn, unsigned frame);
+
+#ifdef USE_TLB
+    /// Unmap page `vpn` from every address space of the text, because its
+    /// frame is taken.  The frame stays marked as in use in `mapTable`.
+    void Evict(unsigned vpn);
+#endif
+
+private:
+
+    SharedText(const char *name, Executable *exe);
+
+    ~SharedText();
+
+    /// File name, and size of its code, to tell it from another file of
+    /// the same name.
+    char *name;
+    uint32_t codeSize;
+
+    /// Pages `firstPage` to `firstPage + numPages - 1`, and their frames.
+    unsigned firstPage;
+    unsigned numPages;
+    int *frames;
+
+    Table<AddressSpace*> sharers;
+};
+
+
+#endif
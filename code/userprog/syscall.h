@@ -67,12 +67,14 @@ SpaceId Exec(char *name, char **argv, int joinable);
 int Join(SpaceId id);
 
 
-/// User-level thread operations: `Fork` and `Yield`.  To allow multiple
-/// threads to run within a user program.
-
-/// Fork a thread to run a procedure (`func`) in the *same* address space as
-/// the current thread.
-int Fork(void (*func)(void));
+/// Process and thread operations: `Fork` and `Yield`.
+
+/// Create a copy of the current process, which runs on from the return of
+/// `Fork`.  Its memory starts out as that of the current process, but is
+/// its own from then on; open files are not inherited.  Returns the
+/// identifier of the new process, which can be joined, or -1 on failure;
+/// in the new process, returns 0.
+SpaceId Fork(void);
 
 /// Yield the CPU to another runnable thread, whether in this address space
 /// or not.
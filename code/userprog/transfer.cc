@@ -7,6 +7,9 @@
 #include "lib/utility.hh"
 #include "threads/system.hh"
 
+#include <string.h>
+
+
 // Plancha 3 - Ejercicio 1
 void ReadBufferFromUser(int userAddress, char *outBuffer,
                         unsigned byteCount)
@@ -14,13 +17,8 @@ void ReadBufferFromUser(int userAddress, char *outBuffer,
     ASSERT(userAddress != 0);
     ASSERT(outBuffer != nullptr);
     ASSERT(byteCount != 0);
-    //DEBUG("Trying to read buffer from user");
 
-    int temp;
-    for(unsigned i = 0; i < byteCount; i++){
-        ASSERT (machine -> ReadMem(userAddress++, 1, &temp));
-        outBuffer[i] = (unsigned char) temp;
-    }
+    ASSERT(machine->ReadBlock(userAddress, outBuffer, byteCount));
 }
 
 bool ReadStringFromUser(int userAddress, char *outString,
@@ -30,15 +28,11 @@ bool ReadStringFromUser(int userAddress, char *outString,
     ASSERT(outString != nullptr);
     ASSERT(maxByteCount != 0);
 
-    unsigned count = 0;
-    do {
-        int temp;
-        count++;
-        ASSERT(machine->ReadMem(userAddress++, 1, &temp));
-        *outString = (unsigned char) temp;
-    } while (*outString++ != '\0' && count < maxByteCount);
-
-    return *(outString - 1) == '\0';
+    // Copy the string with its null, or the first `maxByteCount` bytes.
+    unsigned length = machine->StringLength(userAddress, maxByteCount);
+    unsigned count = length < maxByteCount ? length + 1 : maxByteCount;
+    ASSERT(machine->ReadBlock(userAddress, outString, count));
+    return length < maxByteCount;
 }
 
 // Plancha 3 - Ejercicio 1
@@ -48,10 +42,8 @@ void WriteBufferToUser(const char *buffer, int userAddress,
     ASSERT(userAddress != 0);
     ASSERT(buffer != nullptr);
     ASSERT(byteCount != 0);
-    //DEBUG("Trying to write buffer from user");
 
-    for(unsigned i = 0; i < byteCount; i++)
-        ASSERT (machine -> WriteMem(userAddress++, 1, buffer[i]));
+    ASSERT(machine->WriteBlock(userAddress, buffer, byteCount));
 }
 
 // Plancha 3 - Ejercicio 1
@@ -60,6 +52,5 @@ void WriteStringToUser(const char *string, int userAddress)
     ASSERT(userAddress != 0);
     ASSERT(string != nullptr);
 
-    for (int i = 0; string[i] != '\0'; i++)
-        ASSERT(machine -> WriteMem(userAddress++, 1, string[i]));
+    ASSERT(machine->WriteBlock(userAddress, string, strlen(string)));
 }
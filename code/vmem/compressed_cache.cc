@@ -0,0 +1,240 @@
+/// Copyright (c) 2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "compressed_cache.hh"
+#include "threads/system.hh"
+
+#include <string.h>
+
+
+/// Words in a page, and bytes of the header of a compressed page: two bits
+/// per word.
+static const unsigned PAGE_WORDS = PAGE_SIZE / 4;
+static const unsigned HEADER_SIZE = PAGE_WORDS / 4;
+
+CompressedCache::CompressedCache(unsigned numFrames_, unsigned numSlots_,
+                                 OpenFile *file_)
+{
+    ASSERT(numFrames_ > 0);
+    ASSERT(numSlots_ > 0);
+    ASSERT(file_ != nullptr);
+
+    numFrames = numFrames_;
+    frames    = new unsigned [numFrames];
+    for (unsigned i = 0; i < numFrames; i++) {
+        int frame = mapTable->Find();
+        ASSERT(frame != -1);
+        frames[i] = frame;
+    }
+    chunkMap = new Bitmap(numFrames * PAGE_SIZE / COMPRESSED_CHUNK);
+    DEBUG('e', "Keeping compressed pages in %u frames\n", numFrames);
+
+    numSlots = numSlots_;
+    entries  = new Entry [numSlots];
+    for (unsigned i = 0; i < numSlots; i++)
+        entries[i].kind = NOT_CACHED;
+    newest = oldest = -1;
+    file = file_;
+}
+
+CompressedCache::~CompressedCache()
+{
+    delete [] entries;
+    delete chunkMap;
+    delete [] frames;
+}
+
+bool
+CompressedCache::Store(unsigned slot, const char *page)
+{
+    ASSERT(slot < numSlots);
+    ASSERT(page != nullptr);
+
+    Forget(slot);
+    Entry &entry = entries[slot];
+
+    uint32_t words[PAGE_WORDS];
+    memcpy(words, page, PAGE_SIZE);
+    bool same = true;
+    for (unsigned i = 1; i < PAGE_WORDS && same; i++)
+        same = words[i] == words[0];
+    if (same) {
+        entry.kind = SAME_FILLED;
+        entry.fill = words[0];
+        stats->numPagesCompressed++;
+        stats->numPagesSameFilled++;
+        return true;
+    }
+
+    uint8_t buffer[HEADER_SIZE + PAGE_SIZE];
+    unsigned size = compress(page, buffer);
+    unsigned count = DivRoundUp(size, COMPRESSED_CHUNK);
+    if (count > MAX_COMPRESSED_CHUNKS)
+        return false;
+
+    while (chunkMap->CountClear() < count)
+        writeBackColdest();
+    for (unsigned i = 0; i < count; i++) {
+        entry.chunks[i] = chunkMap->Find();
+        unsigned length = _min(COMPRESSED_CHUNK, size - i * COMPRESSED_CHUNK);
+        memcpy(chunkAddress(entry.chunks[i]), &buffer[i * COMPRESSED_CHUNK],
+               length);
+    }
+    entry.kind = COMPRESSED;
+    entry.size = size;
+    pushNewest(slot);
+    stats->numPagesCompressed++;
+    return true;
+}
+
+bool
+CompressedCache::Load(unsigned slot, char *page)
+{
+    ASSERT(slot < numSlots);
+    ASSERT(page != nullptr);
+
+    if (entries[slot].kind == NOT_CACHED)
+        return false;
+
+    copyOut(slot, page);
+    if (entries[slot].kind == COMPRESSED) {
+        // Recién usada: es la última que se escribe a disco
+        unlink(slot);
+        pushNewest(slot);
+    }
+    stats->numCompressedLoads++;
+    return true;
+}
+
+void
+CompressedCache::copyOut(unsigned slot, char *page) const
+{
+    const Entry &entry = entries[slot];
+    if (entry.kind == SAME_FILLED) {
+        uint32_t words[PAGE_WORDS];
+        for (unsigned i = 0; i < PAGE_WORDS; i++)
+            words[i] = entry.fill;
+        memcpy(page, words, PAGE_SIZE);
+        return;
+    }
+
+    ASSERT(entry.kind == COMPRESSED);
+    uint8_t buffer[HEADER_SIZE + PAGE_SIZE];
+    unsigned count = DivRoundUp(entry.size, COMPRESSED_CHUNK);
+    for (unsigned i = 0; i < count; i++)
+        memcpy(&buffer[i * COMPRESSED_CHUNK], chunkAddress(entry.chunks[i]),
+               COMPRESSED_CHUNK);
+    decompress(buffer, page);
+}
+
+void
+CompressedCache::Forget(unsigned slot)
+{
+    ASSERT(slot < numSlots);
+
+    Entry &entry = entries[slot];
+    if (entry.kind == COMPRESSED) {
+        for (unsigned i = 0; i < DivRoundUp(entry.size, COMPRESSED_CHUNK); i++)
+            chunkMap->Clear(entry.chunks[i]);
+        unlink(slot);
+    }
+    entry.kind = NOT_CACHED;
+}
+
+bool
+CompressedCache::IsCached(unsigned slot) const
+{
+    ASSERT(slot < numSlots);
+
+    return entries[slot].kind != NOT_CACHED;
+}
+
+unsigned
+CompressedCache::compress(const char *page, uint8_t *into)
+{
+    uint32_t words[PAGE_WORDS];
+    memcpy(words, page, PAGE_SIZE);
+
+    // Por cada palabra, dos bits: 0 si es cero, o cuántos bytes ocupa (1,
+    // 2 o 4); después, esos bytes
+    memset(into, 0, HEADER_SIZE);
+    unsigned size = HEADER_SIZE;
+    for (unsigned i = 0; i < PAGE_WORDS; i++) {
+        uint32_t word = words[i];
+        unsigned code = word == 0 ? 0 : word <= 0xFF ? 1 : word <= 0xFFFF ? 2
+                                                                       : 3;
+        into[i / 4] |= code << (i % 4 * 2);
+        unsigned bytes = code == 3 ? 4 : code;
+        for (unsigned j = 0; j < bytes; j++)
+            into[size++] = word >> (j * 8);
+    }
+    return size;
+}
+
+void
+CompressedCache::decompress(const uint8_t *from, char *page)
+{
+    uint32_t words[PAGE_WORDS];
+    unsigned size = HEADER_SIZE;
+    for (unsigned i = 0; i < PAGE_WORDS; i++) {
+        unsigned code = from[i / 4] >> (i % 4 * 2) & 3;
+        unsigned bytes = code == 3 ? 4 : code;
+        words[i] = 0;
+        for (unsigned j = 0; j < bytes; j++)
+            words[i] |= (uint32_t) from[size++] << (j * 8);
+    }
+    memcpy(page, words, PAGE_SIZE);
+}
+
+void
+CompressedCache::writeBackColdest()
+{
+    ASSERT(oldest != -1);
+
+    unsigned slot = oldest;
+    DEBUG('e', "Writing the compressed page of slot %u to swap\n", slot);
+    char page[PAGE_SIZE];
+    copyOut(slot, page);
+    file->WriteAt(page, PAGE_SIZE, slot * PAGE_SIZE);
+    stats->numSwapWrites++;
+    stats->numSwapWriteRequests++;
+    stats->numCompressedWritebacks++;
+    Forget(slot);
+}
+
+char *
+CompressedCache::chunkAddress(unsigned chunk) const
+{
+    unsigned perFrame = PAGE_SIZE / COMPRESSED_CHUNK;
+    unsigned frame = frames[chunk / perFrame];
+    return &machine->GetMMU()->mainMemory[frame * PAGE_SIZE
+                                          + chunk % perFrame * COMPRESSED_CHUNK];
+}
+
+void
+CompressedCache::pushNewest(unsigned slot)
+{
+    entries[slot].older = newest;
+    entries[slot].newer = -1;
+    if (newest != -1)
+        entries[newest].newer = slot;
+    newest = slot;
+    if (oldest == -1)
+        oldest = slot;
+}
+
+void
+CompressedCache::unlink(unsigned slot)
+{
+    Entry &entry = entries[slot];
+    if (entry.older != -1)
+        entries[entry.older].newer = entry.newer;
+    else
+        oldest = entry.newer;
+    if (entry.newer != -1)
+        entries[entry.newer].older = entry.older;
+    else
+        newest = entry.older;
+}
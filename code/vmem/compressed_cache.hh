@@ -0,0 +1,108 @@
+/// Compressed pages kept in memory in front of the swap file.
+///
+/// With `-zs`, some frames are set aside as a pool where pages written to
+/// swap are kept compressed, instead of going to disk; reading them back
+/// costs no disk transfer either.  When the pool runs out of room, the
+/// pages stored longest ago without being read are written to their swap
+/// slots, to make room.
+///
+/// Pages whose words are all the same, such as zero pages, take no room in
+/// the pool at all.  Other pages are compressed word by word: each word is
+/// stored in as few bytes as its value needs, after a header with the size
+/// of each.  That suits the small integers most programs fill their arrays
+/// with; pages that do not shrink enough go straight to disk.  A compressed
+/// page takes any free chunks of `COMPRESSED_CHUNK` bytes of the pool, not
+/// necessarily contiguous.
+///
+/// Copyright (c) 2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_VMEM_COMPRESSEDCACHE__HH
+#define NACHOS_VMEM_COMPRESSEDCACHE__HH
+
+
+#include "filesys/open_file.hh"
+#include "lib/bitmap.hh"
+#include "machine/mmu.hh"
+
+#include <stdint.h>
+
+
+/// Bytes of the pool taken at a time.
+const unsigned COMPRESSED_CHUNK = 16;
+
+/// Most chunks a compressed page may take; pages larger than this are not
+/// worth keeping.
+const unsigned MAX_COMPRESSED_CHUNKS = PAGE_SIZE / COMPRESSED_CHUNK * 3 / 4;
+
+class CompressedCache {
+public:
+
+    /// Set `numFrames` frames aside, taking them from `mapTable`, to keep
+    /// the pages of the `numSlots` slots of the swap file `file`.
+    CompressedCache(unsigned numFrames, unsigned numSlots, OpenFile *file);
+
+    ~CompressedCache();
+
+    /// Keep `page` as the contents of `slot`, writing the coldest pages to
+    /// swap if there is no room.  Returns false, and keeps nothing, if the
+    /// page does not compress well enough.
+    bool Store(unsigned slot, const char *page);
+
+    /// Copy the page kept for `slot` into `page`.  Returns false if there
+    /// is none.
+    bool Load(unsigned slot, char *page);
+
+    /// Drop the page kept for `slot`, if any.
+    void Forget(unsigned slot);
+
+    /// Return whether a page is kept for `slot`.
+    bool IsCached(unsigned slot) const;
+
+private:
+
+    enum Kind { NOT_CACHED, SAME_FILLED, COMPRESSED };
+
+    struct Entry {
+        Kind kind;
+        uint32_t fill;     ///< Every word, if same-filled.
+        unsigned size;     ///< Bytes, if compressed.
+        unsigned chunks[MAX_COMPRESSED_CHUNKS];
+        int older, newer;  ///< Neighbours in the list of compressed pages.
+    };
+
+    /// Compress `page` into `into`, returning the size.
+    static unsigned compress(const char *page, uint8_t *into);
+    static void decompress(const uint8_t *from, char *page);
+
+    /// Copy the page kept for `slot` into `page`.
+    void copyOut(unsigned slot, char *page) const;
+
+    /// Write the compressed page stored longest ago without being read to
+    /// swap, and drop it.
+    void writeBackColdest();
+
+    /// Return where in main memory `chunk` of the pool is.
+    char *chunkAddress(unsigned chunk) const;
+
+    /// Put `slot` first in the list of compressed pages, or take it out.
+    void pushNewest(unsigned slot);
+    void unlink(unsigned slot);
+
+    Entry *entries;
+    unsigned numSlots;
+
+    /// Frames of the pool, and which of their chunks are in use.
+    unsigned *frames;
+    unsigned numFrames;
+    Bitmap *chunkMap;
+
+    /// Compressed pages, from the one stored or read last to the coldest.
+    int newest, oldest;
+
+    OpenFile *file;
+};
+
+
+#endif
@@ -0,0 +1,158 @@
+/// Copyright (c) 2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "core_map.hh"
+#include "threads/system.hh"
+
+
+CoreMap::CoreMap(unsigned size, PagePolicy kind)
+{
+    ASSERT(size > 0);
+
+    numFrames = size;
+    frames    = new Frame [numFrames];
+    for (unsigned i = 0; i < numFrames; i++) {
+        frames[i].space = nullptr;
+        frames[i].vpn   = 0;
+        frames[i].entry = nullptr;
+    }
+    policy = ReplacementPolicy::Create(kind, this);
+    onlySpace      = nullptr;
+    onlyOverTarget = false;
+}
+
+CoreMap::~CoreMap()
+{
+    delete policy;
+    delete [] frames;
+}
+
+void
+CoreMap::Assign(unsigned frame, AddressSpace *space, unsigned vpn,
+                TranslationEntry *entry)
+{
+    ASSERT(frame < numFrames);
+    ASSERT(space != nullptr);
+    ASSERT(entry != nullptr);
+
+    frames[frame].space = space;
+    frames[frame].vpn   = vpn;
+    frames[frame].entry = entry;
+    policy->Loaded(frame);
+}
+
+void
+CoreMap::Release(unsigned frame)
+{
+    ASSERT(frame < numFrames);
+
+    if (frames[frame].space != nullptr)
+        policy->Released(frame);
+    frames[frame].space = nullptr;
+    frames[frame].vpn   = 0;
+    frames[frame].entry = nullptr;
+}
+
+void
+CoreMap::Forget(AddressSpace *space)
+{
+    policy->Forget(space);
+}
+
+unsigned
+CoreMap::GetSize() const
+{
+    return numFrames;
+}
+
+bool
+CoreMap::IsInUse(unsigned frame) const
+{
+    ASSERT(frame < numFrames);
+    return frames[frame].space != nullptr;
+}
+
+AddressSpace *
+CoreMap::GetSpace(unsigned frame) const
+{
+    ASSERT(frame < numFrames);
+    return frames[frame].space;
+}
+
+unsigned
+CoreMap::GetVirtualPage(unsigned frame) const
+{
+    ASSERT(frame < numFrames);
+    ASSERT(frames[frame].space != nullptr);
+    return frames[frame].vpn;
+}
+
+TranslationEntry *
+CoreMap::GetEntry(unsigned frame) const
+{
+    ASSERT(frame < numFrames);
+    return frames[frame].entry;
+}
+
+bool
+CoreMap::IsReferenced(unsigned frame) const
+{
+    ASSERT(IsInUse(frame));
+    return frames[frame].entry->use;
+}
+
+void
+CoreMap::ClearReferenced(unsigned frame)
+{
+    ASSERT(IsInUse(frame));
+    frames[frame].entry->use = false;
+}
+
+bool
+CoreMap::IsDirty(unsigned frame) const
+{
+    ASSERT(IsInUse(frame));
+    return frames[frame].entry->dirty;
+}
+
+void
+CoreMap::Clean(unsigned frame)
+{
+    ASSERT(IsInUse(frame));
+#ifdef USE_TLB
+    frames[frame].space->cleanPage(frames[frame].vpn);
+#endif
+}
+
+bool
+CoreMap::IsCandidate(unsigned frame) const
+{
+    if (!IsInUse(frame))
+        return false;
+    if (onlySpace != nullptr && frames[frame].space != onlySpace)
+        return false;
+    return !onlyOverTarget || frames[frame].space->IsOverTarget();
+}
+
+unsigned
+CoreMap::FindVictim(AddressSpace *space)
+{
+    // Let the page tables show every reference made until now.
+    machine->GetMMU()->WriteBackTlbBits();
+
+    onlySpace = space;
+    if (space == nullptr)
+        for (unsigned i = 0; i < numFrames && !onlyOverTarget; i++)
+            if (IsInUse(i) && frames[i].space->IsOverTarget())
+                onlyOverTarget = true;
+
+    unsigned frame = policy->FindVictim();
+    ASSERT(IsCandidate(frame));
+    onlySpace      = nullptr;
+    onlyOverTarget = false;
+
+    DEBUG('e', "Victim frame %u, page %u\n", frame, frames[frame].vpn);
+    return frame;
+}
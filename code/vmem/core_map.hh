@@ -0,0 +1,103 @@
+/// System-wide record of what each physical page holds.
+///
+/// Pages stay in memory when their process is switched out, so at any time
+/// memory holds pages of several address spaces.  The core map tells, for
+/// each frame, whose page it holds, so that the kernel can take a page out
+/// of memory on behalf of any process when it runs out of frames.
+///
+/// Which frames are free is still kept in `mapTable`; the core map only
+/// describes the frames in use, and chooses which one to free with its
+/// replacement policy.
+///
+/// Copyright (c) 2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_VMEM_COREMAP__HH
+#define NACHOS_VMEM_COREMAP__HH
+
+
+#include "replacement_policy.hh"
+#include "machine/translation_entry.hh"
+
+
+class AddressSpace;
+
+class CoreMap {
+public:
+
+    /// Create a core map for `size` physical pages, all of them free,
+    /// replaced according to `policy`.
+    CoreMap(unsigned size, PagePolicy policy);
+
+    ~CoreMap();
+
+    /// Record that `frame` holds virtual page `vpn` of `space`, whose page
+    /// table entry is `entry`.
+    void Assign(unsigned frame, AddressSpace *space, unsigned vpn,
+                TranslationEntry *entry);
+
+    /// Record that `frame` holds nothing.
+    void Release(unsigned frame);
+
+    /// Note that `space` goes away, after releasing its frames.
+    void Forget(AddressSpace *space);
+
+    /// Return the number of frames.
+    unsigned GetSize() const;
+
+    /// Return whether `frame` holds some page.
+    bool IsInUse(unsigned frame) const;
+
+    /// Return the address space whose page is in `frame`, or null.
+    AddressSpace *GetSpace(unsigned frame) const;
+
+    /// Return the virtual page held by `frame`.
+    unsigned GetVirtualPage(unsigned frame) const;
+
+    /// Return the page table entry of the page held by `frame`, which
+    /// carries its reference and dirty bits.  Bits still in the TLB are
+    /// written back there whenever their entry leaves it.
+    TranslationEntry *GetEntry(unsigned frame) const;
+
+    /// Reference and dirty bits of the page in `frame`, for replacement
+    /// policies.
+    bool IsReferenced(unsigned frame) const;
+    void ClearReferenced(unsigned frame);
+    bool IsDirty(unsigned frame) const;
+
+    /// Write the page in `frame` to swap, so that it is clean.
+    void Clean(unsigned frame);
+
+    /// Choose a frame in use to be freed, as the policy says.
+    ///
+    /// If `space` is given, the frame is one of its own, and there must be
+    /// one.  Otherwise, frames of processes over their resident set target
+    /// are taken first, if there are any (see
+    /// `AddressSpace::GetResidentTarget`); there must be some frame in use.
+    unsigned FindVictim(AddressSpace *space = nullptr);
+
+    /// Return whether `frame` may be chosen by the current call to
+    /// `FindVictim`.
+    bool IsCandidate(unsigned frame) const;
+
+private:
+
+    struct Frame {
+        AddressSpace *space;      ///< Owner, or null if the frame is free.
+        unsigned vpn;
+        TranslationEntry *entry;
+    };
+
+    Frame *frames;
+    unsigned numFrames;
+
+    ReplacementPolicy *policy;
+
+    /// Frames `FindVictim` chooses among.
+    AddressSpace *onlySpace;
+    bool onlyOverTarget;
+};
+
+
+#endif
@@ -0,0 +1,186 @@
+/// Copyright (c) 2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "load_control.hh"
+#include "threads/system.hh"
+
+
+#ifdef USE_TLB
+
+static void
+LoadControlTick(void *arg)
+{
+    ASSERT(arg != nullptr);
+    ((LoadControl *) arg)->ResumeWaiting();
+}
+
+LoadControl::LoadControl(unsigned frames)
+{
+    ASSERT(frames > 0);
+
+    numFrames     = frames;
+    lastResumed   = nullptr;
+    lastTurn      = 0;
+    lastIdleTicks = stats->idleTicks;
+    timer         = new Timer(LoadControlTick, this, false);
+}
+
+LoadControl::~LoadControl()
+{
+    delete timer;
+    for (unsigned i = 0; i < Table<Process*>::SIZE; i++)
+        if (processes.HasKey(i)) {
+            delete processes.Get(i)->resumed;
+            delete processes.Get(i);
+        }
+}
+
+void
+LoadControl::Add(AddressSpace *space)
+{
+    ASSERT(space != nullptr);
+    ASSERT(Find(space) == -1);
+
+    Process *p   = new Process;
+    p->space     = space;
+    p->suspended = false;
+    p->waiting   = false;
+    p->since     = 0;
+    p->resumed   = new Semaphore("load control", 0);
+    ASSERT(processes.Add(p) != -1);
+}
+
+void
+LoadControl::Remove(AddressSpace *space)
+{
+    int i = Find(space);
+    ASSERT(i != -1);
+
+    Process *p = processes.Remove(i);
+    ASSERT(!p->waiting);
+    if (p == lastResumed)
+        lastResumed = nullptr;
+    delete p->resumed;
+    delete p;
+
+    // Its frames are free now.
+    ResumeWaiting();
+}
+
+int
+LoadControl::Find(AddressSpace *space) const
+{
+    for (unsigned i = 0; i < Table<Process*>::SIZE; i++)
+        if (processes.HasKey(i) && processes.Get(i)->space == space)
+            return i;
+    return -1;
+}
+
+unsigned
+LoadControl::CountActive() const
+{
+    unsigned count = 0;
+    for (unsigned i = 0; i < Table<Process*>::SIZE; i++)
+        if (processes.HasKey(i) && !processes.Get(i)->suspended)
+            count++;
+    return count;
+}
+
+unsigned
+LoadControl::GetDemand() const
+{
+    unsigned demand = 0;
+    for (unsigned i = 0; i < Table<Process*>::SIZE; i++)
+        if (processes.HasKey(i) && !processes.Get(i)->suspended)
+            demand += processes.Get(i)->space->GetResidentTarget();
+    return demand;
+}
+
+void
+LoadControl::Admit(AddressSpace *space)
+{
+    int i = Find(space);
+    ASSERT(i != -1);
+    Process *p = processes.Get(i);
+
+    ResumeWaiting();
+    if (!p->suspended && GetDemand() > numFrames && CountActive() > 1)
+        SuspendLargest();
+
+    // Suspended, maybe some time ago and while running: wait to be resumed.
+    while (p->suspended) {
+        DEBUG('e', "Process waits to be resumed\n");
+        p->waiting = true;
+        p->resumed->P();
+        p->waiting = false;
+    }
+}
+
+bool
+LoadControl::SuspendLargest()
+{
+    Process *largest = nullptr;
+    for (unsigned i = 0; i < Table<Process*>::SIZE; i++) {
+        if (!processes.HasKey(i))
+            continue;
+        Process *p = processes.Get(i);
+        if (!p->suspended && p != lastResumed && (largest == nullptr
+              || p->space->GetResidentPages()
+                   > largest->space->GetResidentPages()))
+            largest = p;
+    }
+    if (largest == nullptr)
+        return false;
+
+    DEBUG('e', "Demand of %u frames, suspending a process with %u pages "
+          "in memory\n", GetDemand(), largest->space->GetResidentPages());
+    largest->suspended = true;
+    largest->since     = stats->totalTicks;
+    largest->space->swapOut();
+    stats->numSuspensions++;
+    return true;
+}
+
+void
+LoadControl::ResumeWaiting()
+{
+    bool idle = stats->idleTicks != lastIdleTicks;
+    lastIdleTicks = stats->idleTicks;
+
+    for (;;) {
+        // The process suspended the longest ago goes first.
+        Process *next = nullptr;
+        for (unsigned i = 0; i < Table<Process*>::SIZE; i++) {
+            if (!processes.HasKey(i))
+                continue;
+            Process *p = processes.Get(i);
+            if (p->suspended && (next == nullptr || p->since < next->since))
+                next = p;
+        }
+        if (next == nullptr)
+            return;
+
+        bool fits = CountActive() == 0
+          || GetDemand() + next->space->GetResidentTarget() <= numFrames;
+        if (!fits) {
+            bool turn = stats->totalTicks - next->since >= LOAD_CONTROL_WAIT
+              && stats->totalTicks - lastTurn >= LOAD_CONTROL_WAIT;
+            if (!idle && !turn)
+                return;
+            lastTurn = stats->totalTicks;
+        }
+
+        DEBUG('e', "Resuming a process with a target of %u pages\n",
+              next->space->GetResidentTarget());
+        next->suspended = false;
+        lastResumed     = next;
+        if (next->waiting)
+            next->resumed->V();
+        if (!fits)
+            return;  // Its turn came: one at a time.
+    }
+}
+
+#endif
@@ -0,0 +1,102 @@
+/// Load control: keeping the working sets of running processes in memory.
+///
+/// Every address space estimates how many frames it needs, its resident
+/// set target, from how often it faults (see `AddressSpace::LoadPage`).
+/// When the targets of all running processes add up to more than the
+/// physical memory, every process would keep taking frames from the
+/// others, and the machine would spend its time paging instead of running
+/// anything (thrashing).  Load control avoids that by suspending processes
+/// until the rest fit: the pages of a suspended process are all taken out
+/// of memory, and it does not run again until it is resumed.
+///
+/// A process is resumed as soon as its target fits besides those of the
+/// running ones.  Otherwise, the one suspended the longest ago is resumed
+/// anyway when the machine goes idle, because every running process is
+/// blocked (for instance, joining a child that is itself suspended), or
+/// when it has waited `LOAD_CONTROL_WAIT` ticks, but only one every
+/// `LOAD_CONTROL_WAIT` ticks, so that suspended processes take turns
+/// without thrashing.  The process resumed last is not suspended again
+/// until some other is resumed.  Load control is enabled with `-lc`.
+///
+/// Copyright (c) 2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_VMEM_LOADCONTROL__HH
+#define NACHOS_VMEM_LOADCONTROL__HH
+
+
+#include "lib/table.hh"
+#include "machine/timer.hh"
+#include "threads/synch.hh"
+
+
+class AddressSpace;
+
+/// Time, in ticks, between turns of suspended processes.
+const unsigned long LOAD_CONTROL_WAIT = 50000;
+
+class LoadControl {
+public:
+
+    /// Keep the demand of running processes within `numFrames` frames.
+    LoadControl(unsigned numFrames);
+
+    ~LoadControl();
+
+    /// Start and stop keeping track of `space`.
+    void Add(AddressSpace *space);
+    void Remove(AddressSpace *space);
+
+    /// Let `space`, that just had a page fault, go on.
+    ///
+    /// If the demand for memory is too high, some process is suspended,
+    /// which may be `space` itself.  If `space` is suspended, the calling
+    /// thread waits here until it is resumed.
+    void Admit(AddressSpace *space);
+
+    /// Return the sum of the resident set targets of processes not
+    /// suspended.
+    unsigned GetDemand() const;
+
+    /// Resume suspended processes that fit, or whose turn came.  Called
+    /// from the timer interrupt, too.
+    void ResumeWaiting();
+
+private:
+
+    struct Process {
+        AddressSpace *space;
+        bool suspended;
+        bool waiting;           ///< Whether its thread waits in `Admit`.
+        unsigned long since;    ///< When it was suspended.
+        Semaphore *resumed;
+    };
+
+    /// Return the index of `space` in `processes`, or -1.
+    int Find(AddressSpace *space) const;
+
+    /// Return how many processes are not suspended.
+    unsigned CountActive() const;
+
+    /// Suspend the running process with the most pages in memory, other
+    /// than the one resumed last.  Returns false if there is none.
+    bool SuspendLargest();
+
+    Table<Process*> processes;
+    unsigned numFrames;
+
+    /// Periodically looks for processes to resume.
+    Timer *timer;
+
+    /// Process resumed last, if it is still around.
+    Process *lastResumed;
+
+    /// When a process was last resumed without fitting, and idle ticks
+    /// of the machine as of the last look.
+    unsigned long lastTurn;
+    unsigned long lastIdleTicks;
+};
+
+
+#endif
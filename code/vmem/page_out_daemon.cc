@@ -0,0 +1,86 @@
+/// Copyright (c) 2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "page_out_daemon.hh"
+#include "threads/system.hh"
+
+
+#ifdef USE_TLB
+
+static void
+PageOutThread(void *arg)
+{
+    ASSERT(arg != nullptr);
+    ((PageOutDaemon *) arg)->Run();
+}
+
+PageOutDaemon::PageOutDaemon(unsigned low_, unsigned high_)
+{
+    ASSERT(0 < low_ && low_ <= high_ && high_ < NUM_PHYS_PAGES);
+
+    low         = low_;
+    high        = high_;
+    awake       = false;
+    wakeUp      = new Semaphore("page-out wake up", 0);
+    numWaiting  = 0;
+    framesFreed = new Semaphore("page-out frames", 0);
+
+    // Freeing frames comes before anything that may need them.
+    Thread *t = new Thread("page-out daemon", false, MAX_PRIORITY);
+    t->Fork(PageOutThread, this);
+}
+
+PageOutDaemon::~PageOutDaemon()
+{
+    delete wakeUp;
+    delete framesFreed;
+}
+
+void
+PageOutDaemon::Check()
+{
+    if (!awake && mapTable->CountClear() < low) {
+        DEBUG('e', "%u frames free, waking the page-out daemon up\n",
+              mapTable->CountClear());
+        awake = true;
+        wakeUp->V();
+    }
+}
+
+void
+PageOutDaemon::WaitForFrames()
+{
+    ASSERT(mapTable->CountClear() == 0);
+
+    Check();
+    numWaiting++;
+    framesFreed->P();
+}
+
+void
+PageOutDaemon::Run()
+{
+    for (;;) {
+        wakeUp->P();
+
+        DEBUG('e', "Page-out daemon freeing frames, %u free\n",
+              mapTable->CountClear());
+        while (mapTable->CountClear() < high) {
+            unsigned frame = coreMap->FindVictim();
+            AddressSpace *owner = coreMap->GetSpace(frame);
+            unsigned vpn = coreMap->GetVirtualPage(frame);
+            owner->saveClusterInSwap(vpn);
+            owner->evictPage(vpn);
+            mapTable->Clear(frame);
+            stats->numPagesFreed++;
+        }
+
+        awake = false;
+        for (; numWaiting > 0; numWaiting--)
+            framesFreed->V();
+    }
+}
+
+#endif
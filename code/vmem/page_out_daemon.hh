@@ -0,0 +1,69 @@
+/// Kernel thread that frees frames ahead of demand.
+///
+/// Without it, a page fault on a full memory evicts a page right there,
+/// writing it to swap first if it is dirty.  With it, page faults take
+/// frames from a pool of free ones, and the daemon refills the pool in the
+/// background: it is woken up when fewer than `low` frames are free, and
+/// evicts pages, as the replacement policy says, until `high` frames are
+/// free.  A fault that finds no free frame at all waits for it.
+///
+/// Dirty pages are written in clusters: together with a dirty victim, the
+/// dirty pages in memory next to it in the same address space are written
+/// with a single swap write, and stay in memory, clean.
+///
+/// The daemon is started with `-pd`.
+///
+/// Copyright (c) 2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_VMEM_PAGEOUTDAEMON__HH
+#define NACHOS_VMEM_PAGEOUTDAEMON__HH
+
+
+#include "machine/mmu.hh"
+#include "threads/synch.hh"
+
+
+/// Most pages written to swap at once.
+const unsigned PAGE_OUT_CLUSTER = 8;
+
+/// Watermarks, in free frames.
+const unsigned PAGE_OUT_LOW  = NUM_PHYS_PAGES / 16;
+const unsigned PAGE_OUT_HIGH = NUM_PHYS_PAGES / 8;
+
+class PageOutDaemon {
+public:
+
+    /// Start the daemon, keeping between `low` and `high` frames free.
+    PageOutDaemon(unsigned low, unsigned high);
+
+    ~PageOutDaemon();
+
+    /// Wake the daemon up if free frames are running low.  To be called
+    /// after taking free frames.
+    void Check();
+
+    /// Wait until the daemon frees some frames.  To be called when there
+    /// are none.
+    void WaitForFrames();
+
+    /// Body of the daemon thread.
+    void Run();
+
+private:
+
+    unsigned low;
+    unsigned high;
+
+    /// Whether the daemon was woken up and did not finish its work yet.
+    bool awake;
+    Semaphore *wakeUp;
+
+    /// Threads waiting for frames, and where they wait.
+    unsigned numWaiting;
+    Semaphore *framesFreed;
+};
+
+
+#endif
@@ -0,0 +1,438 @@
+/// Copyright (c) 2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "replacement_policy.hh"
+#include "core_map.hh"
+#include "threads/system.hh"
+
+#include <string.h>
+
+
+static const char *const PAGE_POLICY_NAMES[] = {
+    "fifo", "clock", "enhanced", "wsclock", "aging", "arc"
+};
+
+PagePolicy
+PagePolicyFromString(const char *name)
+{
+    ASSERT(name != nullptr);
+
+    unsigned i;
+    for (i = 0; i < NUM_PAGE_POLICIES; i++)
+        if (strcmp(name, PAGE_POLICY_NAMES[i]) == 0)
+            break;
+    return (PagePolicy) i;
+}
+
+ReplacementPolicy *
+ReplacementPolicy::Create(PagePolicy kind, CoreMap *frames)
+{
+    DEBUG('e', "Using the %s page replacement policy\n",
+          PAGE_POLICY_NAMES[kind]);
+    switch (kind) {
+        case FIFO_PAGE_POLICY:
+            return new FifoPolicy(frames);
+        case CLOCK_PAGE_POLICY:
+            return new ClockPolicy(frames);
+        case ENHANCED_PAGE_POLICY:
+            return new EnhancedSecondChancePolicy(frames);
+        case WSCLOCK_PAGE_POLICY:
+            return new WsClockPolicy(frames);
+        case AGING_PAGE_POLICY:
+            return new AgingPolicy(frames);
+        case ARC_PAGE_POLICY:
+            return new ArcPolicy(frames);
+        default:
+            ASSERT(false);
+            return nullptr;
+    }
+}
+
+ReplacementPolicy::ReplacementPolicy(CoreMap *coreMap_)
+{
+    ASSERT(coreMap_ != nullptr);
+
+    coreMap   = coreMap_;
+    numFrames = coreMap->GetSize();
+}
+
+ReplacementPolicy::~ReplacementPolicy()
+{}
+
+void
+ReplacementPolicy::Forget(AddressSpace *space)
+{}
+
+
+FifoPolicy::FifoPolicy(CoreMap *coreMap_)
+  : ReplacementPolicy(coreMap_)
+{
+    loaded = new unsigned long [numFrames];
+    time   = 0;
+}
+
+FifoPolicy::~FifoPolicy()
+{
+    delete [] loaded;
+}
+
+void
+FifoPolicy::Loaded(unsigned frame)
+{
+    loaded[frame] = ++time;
+}
+
+void
+FifoPolicy::Released(unsigned frame)
+{}
+
+unsigned
+FifoPolicy::FindVictim()
+{
+    int victim = -1;
+    for (unsigned i = 0; i < numFrames; i++)
+        if (coreMap->IsCandidate(i)
+              && (victim == -1 || loaded[i] < loaded[victim]))
+            victim = i;
+    ASSERT(victim != -1);
+    return victim;
+}
+
+
+ClockPolicy::ClockPolicy(CoreMap *coreMap_)
+  : ReplacementPolicy(coreMap_)
+{
+    hand = 0;
+}
+
+void
+ClockPolicy::Loaded(unsigned frame)
+{}
+
+void
+ClockPolicy::Released(unsigned frame)
+{}
+
+unsigned
+ClockPolicy::FindVictim()
+{
+    // Two rounds at most: the first one clears every reference bit.
+    for (unsigned i = 0; i < 2 * numFrames; i++) {
+        unsigned frame = hand;
+        hand = (hand + 1) % numFrames;
+        if (!coreMap->IsCandidate(frame))
+            continue;
+        if (!coreMap->IsReferenced(frame))
+            return frame;
+        coreMap->ClearReferenced(frame);
+    }
+    ASSERT(false);  // Nothing in memory.
+    return 0;
+}
+
+
+EnhancedSecondChancePolicy::EnhancedSecondChancePolicy(CoreMap *coreMap_)
+  : ReplacementPolicy(coreMap_)
+{
+    hand = 0;
+}
+
+void
+EnhancedSecondChancePolicy::Loaded(unsigned frame)
+{}
+
+void
+EnhancedSecondChancePolicy::Released(unsigned frame)
+{}
+
+unsigned
+EnhancedSecondChancePolicy::FindVictim()
+{
+    // By the second time around, every reference bit is clear.
+    for (unsigned round = 0; round < 2; round++) {
+        // Not referenced, clean.
+        for (unsigned i = 0; i < numFrames; i++) {
+            unsigned frame = (hand + i) % numFrames;
+            if (coreMap->IsCandidate(frame) && !coreMap->IsReferenced(frame)
+                  && !coreMap->IsDirty(frame)) {
+                hand = (frame + 1) % numFrames;
+                return frame;
+            }
+        }
+        // Not referenced, dirty; give referenced pages a second chance.
+        for (unsigned i = 0; i < numFrames; i++) {
+            unsigned frame = (hand + i) % numFrames;
+            if (!coreMap->IsCandidate(frame))
+                continue;
+            if (!coreMap->IsReferenced(frame)) {
+                hand = (frame + 1) % numFrames;
+                return frame;
+            }
+            coreMap->ClearReferenced(frame);
+        }
+    }
+    ASSERT(false);  // Nothing in memory.
+    return 0;
+}
+
+
+WsClockPolicy::WsClockPolicy(CoreMap *coreMap_)
+  : ReplacementPolicy(coreMap_)
+{
+    hand    = 0;
+    lastUse = new unsigned long [numFrames];
+}
+
+WsClockPolicy::~WsClockPolicy()
+{
+    delete [] lastUse;
+}
+
+void
+WsClockPolicy::Loaded(unsigned frame)
+{
+    lastUse[frame] = stats->totalTicks;
+}
+
+void
+WsClockPolicy::Released(unsigned frame)
+{}
+
+unsigned
+WsClockPolicy::FindVictim()
+{
+    unsigned long now = stats->totalTicks;
+    int oldest = -1;
+
+    // Pages cleaned in the first round can go in the second one.
+    for (unsigned i = 0; i < 2 * numFrames; i++) {
+        unsigned frame = hand;
+        hand = (hand + 1) % numFrames;
+        if (!coreMap->IsCandidate(frame))
+            continue;
+
+        if (coreMap->IsReferenced(frame)) {
+            coreMap->ClearReferenced(frame);
+            lastUse[frame] = now;
+        } else if (now - lastUse[frame] > WSCLOCK_WINDOW) {
+            if (!coreMap->IsDirty(frame))
+                return frame;
+            coreMap->Clean(frame);
+        }
+        if (oldest == -1 || lastUse[frame] < lastUse[oldest])
+            oldest = frame;
+    }
+
+    // Every page is in some working set: evict the least recently used.
+    ASSERT(oldest != -1);
+    return oldest;
+}
+
+
+AgingPolicy::AgingPolicy(CoreMap *coreMap_)
+  : ReplacementPolicy(coreMap_)
+{
+    age  = new unsigned char [numFrames];
+    hand = 0;
+}
+
+AgingPolicy::~AgingPolicy()
+{
+    delete [] age;
+}
+
+void
+AgingPolicy::Loaded(unsigned frame)
+{
+    age[frame] = 0x80;  // Just referenced.
+}
+
+void
+AgingPolicy::Released(unsigned frame)
+{}
+
+unsigned
+AgingPolicy::FindVictim()
+{
+    int victim = -1;
+    for (unsigned i = 0; i < numFrames; i++) {
+        unsigned frame = (hand + i) % numFrames;
+        if (!coreMap->IsInUse(frame))
+            continue;
+        age[frame] >>= 1;
+        if (coreMap->IsReferenced(frame)) {
+            age[frame] |= 0x80;
+            coreMap->ClearReferenced(frame);
+        }
+        if (coreMap->IsCandidate(frame)
+              && (victim == -1 || age[frame] < age[victim]))
+            victim = frame;
+    }
+    ASSERT(victim != -1);
+    hand = (victim + 1) % numFrames;
+    return victim;
+}
+
+
+ArcPolicy::ArcPolicy(CoreMap *coreMap_)
+  : ReplacementPolicy(coreMap_)
+{
+    lists  = new ListId [numFrames];
+    stamps = new unsigned long [numFrames];
+    ghosts = new Ghost [numFrames];
+    for (unsigned i = 0; i < numFrames; i++) {
+        lists[i]        = NO_LIST;
+        stamps[i]       = 0;
+        ghosts[i].list  = NO_LIST;
+        ghosts[i].space = nullptr;
+    }
+    time   = 0;
+    target = 0;
+}
+
+ArcPolicy::~ArcPolicy()
+{
+    delete [] lists;
+    delete [] stamps;
+    delete [] ghosts;
+}
+
+unsigned
+ArcPolicy::Count(ListId list) const
+{
+    bool resident = list == T1_LIST || list == T2_LIST;
+    unsigned count = 0;
+    for (unsigned i = 0; i < numFrames; i++)
+        if (resident ? lists[i] == list : ghosts[i].list == list)
+            count++;
+    return count;
+}
+
+ArcPolicy::Ghost *
+ArcPolicy::FindGhost(AddressSpace *space, unsigned vpn)
+{
+    for (unsigned i = 0; i < numFrames; i++)
+        if (ghosts[i].list != NO_LIST && ghosts[i].space == space
+              && ghosts[i].vpn == vpn)
+            return &ghosts[i];
+    return nullptr;
+}
+
+void
+ArcPolicy::AddGhost(ListId list, unsigned frame)
+{
+    ASSERT(list == B1_LIST || list == B2_LIST);
+
+    // A free slot, or else that of the least recent ghost of `list`.
+    Ghost *slot = nullptr;
+    for (unsigned i = 0; i < numFrames && slot == nullptr; i++)
+        if (ghosts[i].list == NO_LIST)
+            slot = &ghosts[i];
+    if (slot == nullptr)
+        slot = LeastRecentGhost(list);
+    if (slot == nullptr)
+        slot = LeastRecentGhost(list == B1_LIST ? B2_LIST : B1_LIST);
+    ASSERT(slot != nullptr);
+
+    slot->list  = list;
+    slot->space = coreMap->GetSpace(frame);
+    slot->vpn   = coreMap->GetVirtualPage(frame);
+    slot->stamp = ++time;
+}
+
+ArcPolicy::Ghost *
+ArcPolicy::LeastRecentGhost(ListId list)
+{
+    Ghost *ghost = nullptr;
+    for (unsigned i = 0; i < numFrames; i++)
+        if (ghosts[i].list == list
+              && (ghost == nullptr || ghosts[i].stamp < ghost->stamp))
+            ghost = &ghosts[i];
+    return ghost;
+}
+
+int
+ArcPolicy::LeastRecent(ListId list) const
+{
+    int frame = -1;
+    for (unsigned i = 0; i < numFrames; i++)
+        if (lists[i] == list && coreMap->IsCandidate(i)
+              && (frame == -1 || stamps[i] < stamps[frame]))
+            frame = i;
+    return frame;
+}
+
+void
+ArcPolicy::Loaded(unsigned frame)
+{
+    Ghost *ghost = FindGhost(coreMap->GetSpace(frame),
+                             coreMap->GetVirtualPage(frame));
+    if (ghost == nullptr) {
+        // Never seen, or forgotten: keep `T1` and `B1` within the size of
+        // memory, and all four lists within twice that.
+        unsigned t1 = Count(T1_LIST), b1 = Count(B1_LIST);
+        Ghost *drop = nullptr;
+        if (t1 + b1 >= numFrames)
+            drop = LeastRecentGhost(B1_LIST);
+        else if (t1 + b1 + Count(T2_LIST) + Count(B2_LIST) >= 2 * numFrames)
+            drop = LeastRecentGhost(B2_LIST);
+        if (drop != nullptr)
+            drop->list = NO_LIST;
+        lists[frame] = T1_LIST;
+    } else {
+        // Evicted too soon: adapt towards the list it was evicted from.
+        unsigned b1 = Count(B1_LIST), b2 = Count(B2_LIST);
+        if (ghost->list == B1_LIST) {
+            unsigned delta = b1 >= b2 ? 1 : b2 / b1;
+            target = _min(target + delta, numFrames);
+        } else {
+            unsigned delta = b2 >= b1 ? 1 : b1 / b2;
+            target = target > delta ? target - delta : 0;
+        }
+        ghost->list = NO_LIST;
+        lists[frame] = T2_LIST;
+    }
+    stamps[frame] = ++time;
+}
+
+void
+ArcPolicy::Released(unsigned frame)
+{
+    lists[frame] = NO_LIST;
+}
+
+void
+ArcPolicy::Forget(AddressSpace *space)
+{
+    for (unsigned i = 0; i < numFrames; i++)
+        if (ghosts[i].space == space)
+            ghosts[i].list = NO_LIST;
+}
+
+unsigned
+ArcPolicy::FindVictim()
+{
+    // Pages referenced since the last time were hit again: they go to the
+    // most recent end of `T2`.
+    for (unsigned i = 0; i < numFrames; i++) {
+        if (lists[i] != NO_LIST && coreMap->IsReferenced(i)) {
+            coreMap->ClearReferenced(i);
+            lists[i]  = T2_LIST;
+            stamps[i] = ++time;
+        }
+    }
+
+    int first = LeastRecent(T1_LIST), second = LeastRecent(T2_LIST);
+    int victim;
+    if (first != -1 && (Count(T1_LIST) >= target || second == -1)) {
+        victim = first;
+        AddGhost(B1_LIST, victim);
+    } else {
+        victim = second;
+        ASSERT(victim != -1);
+        AddGhost(B2_LIST, victim);
+    }
+    return victim;
+}
@@ -0,0 +1,197 @@
+/// Page replacement policies.
+///
+/// When a page fault finds every frame in use, the kernel asks the policy
+/// for a frame to free, whoever its owner.  Policies are told about every
+/// frame that gets a page and every frame that loses it, and read the
+/// `use` and `dirty` bits of the page in each frame through the core map.
+/// Reference bits are collected from the TLB right before each decision
+/// (see `MMU::WriteBackTlbBits`).
+///
+/// The policy is chosen at startup, with `-rp`.
+///
+/// Copyright (c) 2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_VMEM_REPLACEMENTPOLICY__HH
+#define NACHOS_VMEM_REPLACEMENTPOLICY__HH
+
+
+class AddressSpace;
+class CoreMap;
+
+enum PagePolicy {
+    FIFO_PAGE_POLICY,      ///< Oldest loaded.
+    CLOCK_PAGE_POLICY,     ///< Second chance, by reference bits.
+    ENHANCED_PAGE_POLICY,  ///< Second chance, by reference and dirty bits.
+    WSCLOCK_PAGE_POLICY,   ///< Clock over pages out of the working set.
+    AGING_PAGE_POLICY,     ///< Least recently used, by aging counters.
+    ARC_PAGE_POLICY,       ///< Adaptive replacement cache.
+    NUM_PAGE_POLICIES
+};
+
+/// Return the policy named `name` (`fifo`, `clock`, `enhanced`, `wsclock`,
+/// `aging` or `arc`), or `NUM_PAGE_POLICIES` if there is no such policy.
+PagePolicy PagePolicyFromString(const char *name);
+
+class ReplacementPolicy {
+public:
+
+    /// Return a new policy of kind `kind`, for `frames`.
+    static ReplacementPolicy *Create(PagePolicy kind, CoreMap *frames);
+
+    virtual ~ReplacementPolicy();
+
+    /// Note that `frame` just got a page.
+    virtual void Loaded(unsigned frame) = 0;
+
+    /// Note that `frame` is losing its page, because it is evicted or
+    /// because its address space goes away.
+    virtual void Released(unsigned frame) = 0;
+
+    /// Forget whatever is remembered about pages of `space`, which goes
+    /// away.
+    virtual void Forget(AddressSpace *space);
+
+    /// Choose a frame to be freed, among those the core map says are
+    /// candidates (see `CoreMap::IsCandidate`).
+    virtual unsigned FindVictim() = 0;
+
+protected:
+
+    ReplacementPolicy(CoreMap *coreMap);
+
+    CoreMap *coreMap;
+    unsigned numFrames;
+};
+
+/// Evict the page loaded the longest ago.
+class FifoPolicy : public ReplacementPolicy {
+public:
+    FifoPolicy(CoreMap *coreMap);
+    ~FifoPolicy();
+    void Loaded(unsigned frame);
+    void Released(unsigned frame);
+    unsigned FindVictim();
+
+private:
+    unsigned long *loaded;  ///< When each frame got its page.
+    unsigned long time;
+};
+
+/// Go around the frames, clearing reference bits, and evict the first page
+/// not referenced since the last round.
+class ClockPolicy : public ReplacementPolicy {
+public:
+    ClockPolicy(CoreMap *coreMap);
+    void Loaded(unsigned frame);
+    void Released(unsigned frame);
+    unsigned FindVictim();
+
+private:
+    unsigned hand;
+};
+
+/// Like the clock, but prefer clean pages to dirty ones: look for a page
+/// neither referenced nor dirty, then for one not referenced, clearing
+/// reference bits, and start over if needed.
+class EnhancedSecondChancePolicy : public ReplacementPolicy {
+public:
+    EnhancedSecondChancePolicy(CoreMap *coreMap);
+    void Loaded(unsigned frame);
+    void Released(unsigned frame);
+    unsigned FindVictim();
+
+private:
+    unsigned hand;
+};
+
+/// Clock over working sets: a page not referenced for `WSCLOCK_WINDOW`
+/// ticks is out of the working set of its process.  Clean pages out of
+/// their working set are evicted; dirty ones are written to swap on the
+/// way, so that they are clean the next time around.
+class WsClockPolicy : public ReplacementPolicy {
+public:
+    WsClockPolicy(CoreMap *coreMap);
+    ~WsClockPolicy();
+    void Loaded(unsigned frame);
+    void Released(unsigned frame);
+    unsigned FindVictim();
+
+private:
+    unsigned hand;
+    unsigned long *lastUse;  ///< Last time each page was seen referenced.
+};
+
+/// Age of a page, in ticks, after which `WsClockPolicy` takes it to be out
+/// of the working set.
+const unsigned long WSCLOCK_WINDOW = 20000;
+
+/// Approximate least recently used: every time a victim is needed, the
+/// counter of each frame is shifted right, with the reference bit of its
+/// page going into the top bit.  The page with the lowest counter goes.
+class AgingPolicy : public ReplacementPolicy {
+public:
+    AgingPolicy(CoreMap *coreMap);
+    ~AgingPolicy();
+    void Loaded(unsigned frame);
+    void Released(unsigned frame);
+    unsigned FindVictim();
+
+private:
+    unsigned char *age;
+    unsigned hand;  ///< Where ties start being broken.
+};
+
+/// Adaptive replacement cache (Megiddo and Modha).
+///
+/// Resident pages are split between `T1`, seen once, and `T2`, seen
+/// referenced again since they were loaded.  Pages recently evicted from
+/// each are remembered in the ghost lists `B1` and `B2`; a fault on a page
+/// in a ghost list moves the target size of `T1` towards the list that
+/// would have kept it.  Recency in each list is kept with time stamps.
+class ArcPolicy : public ReplacementPolicy {
+public:
+    ArcPolicy(CoreMap *coreMap);
+    ~ArcPolicy();
+    void Loaded(unsigned frame);
+    void Released(unsigned frame);
+    void Forget(AddressSpace *space);
+    unsigned FindVictim();
+
+private:
+    enum ListId { NO_LIST, T1_LIST, T2_LIST, B1_LIST, B2_LIST };
+
+    /// A page in a ghost list.
+    struct Ghost {
+        ListId list;
+        AddressSpace *space;
+        unsigned vpn;
+        unsigned long stamp;
+    };
+
+    /// Return how many resident pages or ghosts are in `list`.
+    unsigned Count(ListId list) const;
+
+    /// Return the ghost of page `vpn` of `space`, or null.
+    Ghost *FindGhost(AddressSpace *space, unsigned vpn);
+
+    /// Remember the page in `frame` in ghost list `list`, in place of the
+    /// least recent ghost of that list if there is no room.
+    void AddGhost(ListId list, unsigned frame);
+
+    /// Return the least recent ghost of `list`, or null.
+    Ghost *LeastRecentGhost(ListId list);
+
+    /// Return the least recent candidate page of `list`, or -1.
+    int LeastRecent(ListId list) const;
+
+    ListId *lists;         ///< List of the page in each frame.
+    unsigned long *stamps; ///< Last time each frame moved in its list.
+    Ghost *ghosts;         ///< Up to `numFrames` ghosts, in `B1` or `B2`.
+    unsigned long time;
+    unsigned target;       ///< Target size of `T1`.
+};
+
+
+#endif
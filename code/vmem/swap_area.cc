@@ -0,0 +1,158 @@
+/// Copyright (c) 2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "swap_area.hh"
+#include "threads/system.hh"
+
+#include <string.h>
+
+
+SwapArea::SwapArea(const char *name, unsigned size, unsigned cacheFrames)
+{
+    ASSERT(name != nullptr);
+    ASSERT(size > 0);
+
+    fileName = new char [strlen(name) + 1];
+    strcpy(fileName, name);
+    DEBUG('e', "Creating swap file `%s`, %u slots\n", fileName, size);
+    ASSERT(fileSystem->Create(fileName, size * PAGE_SIZE, false));
+    file = fileSystem->Open(fileName);
+    ASSERT(file != nullptr);
+
+    numSlots = size;
+    slots    = new Bitmap(numSlots);
+    refs     = new unsigned [numSlots];
+    for (unsigned i = 0; i < numSlots; i++)
+        refs[i] = 0;
+    cache = cacheFrames > 0 ? new CompressedCache(cacheFrames, numSlots, file)
+                            : nullptr;
+}
+
+SwapArea::~SwapArea()
+{
+    delete cache;
+    delete file;
+    fileSystem->Remove(fileName);
+    delete [] fileName;
+    delete slots;
+    delete [] refs;
+}
+
+int
+SwapArea::Allocate()
+{
+    return AllocateRun(1);
+}
+
+int
+SwapArea::AllocateRun(unsigned count)
+{
+    ASSERT(count > 0);
+
+    unsigned run = 0;
+    for (unsigned i = 0; i < numSlots; i++) {
+        run = slots->Test(i) ? 0 : run + 1;
+        if (run == count) {
+            unsigned first = i + 1 - count;
+            for (unsigned j = first; j <= i; j++) {
+                slots->Mark(j);
+                refs[j] = 1;
+            }
+            return first;
+        }
+    }
+    return -1;
+}
+
+void
+SwapArea::Share(unsigned slot)
+{
+    ASSERT(slot < numSlots);
+    ASSERT(refs[slot] > 0);
+
+    refs[slot]++;
+}
+
+void
+SwapArea::Free(unsigned slot)
+{
+    ASSERT(slot < numSlots);
+    ASSERT(refs[slot] > 0);
+
+    if (--refs[slot] == 0) {
+        slots->Clear(slot);
+        if (cache != nullptr)
+            cache->Forget(slot);
+    }
+}
+
+bool
+SwapArea::IsShared(unsigned slot) const
+{
+    ASSERT(slot < numSlots);
+
+    return refs[slot] > 1;
+}
+
+void
+SwapArea::ReadPages(char *into, unsigned slot, unsigned count)
+{
+    ASSERT(into != nullptr);
+    ASSERT(slot + count <= numSlots);
+
+    // Las páginas que no están en el caché se leen de a tramos
+    unsigned first = 0;
+    for (unsigned i = 0; i <= count; i++) {
+        bool cached = i < count && cache != nullptr
+                      && cache->Load(slot + i, &into[i * PAGE_SIZE]);
+        if (i == count || cached) {
+            if (i > first)
+                readFromDisk(&into[first * PAGE_SIZE], slot + first,
+                             i - first);
+            first = i + 1;
+        }
+    }
+}
+
+void
+SwapArea::WritePages(const char *from, unsigned slot, unsigned count)
+{
+    ASSERT(from != nullptr);
+    ASSERT(slot + count <= numSlots);
+
+    // Las páginas que no entran en el caché se escriben de a tramos
+    unsigned first = 0;
+    for (unsigned i = 0; i <= count; i++) {
+        bool cached = i < count && cache != nullptr
+                      && cache->Store(slot + i, &from[i * PAGE_SIZE]);
+        if (i == count || cached) {
+            if (i > first)
+                writeToDisk(&from[first * PAGE_SIZE], slot + first,
+                            i - first);
+            first = i + 1;
+        }
+    }
+}
+
+void
+SwapArea::readFromDisk(char *into, unsigned slot, unsigned count)
+{
+    file->ReadAt(into, count * PAGE_SIZE, slot * PAGE_SIZE);
+    stats->numSwapReads += count;
+}
+
+void
+SwapArea::writeToDisk(const char *from, unsigned slot, unsigned count)
+{
+    file->WriteAt(from, count * PAGE_SIZE, slot * PAGE_SIZE);
+    stats->numSwapWrites += count;
+    stats->numSwapWriteRequests++;
+}
+
+unsigned
+SwapArea::CountFree() const
+{
+    return slots->CountClear();
+}
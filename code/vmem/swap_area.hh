@@ -0,0 +1,87 @@
+/// Swap area shared by every process.
+///
+/// Pages taken out of memory are written to a single file, created when
+/// Nachos starts, made of page-sized slots.  A page gets a slot only when
+/// it is first written to swap, and keeps it while its copy there is up to
+/// date, so that a clean page can be dropped from memory and read back
+/// later; the slot is given back when the process exits.  Creating a
+/// process does not touch the file system for swap.
+///
+/// A slot may hold the page of several processes, after `Fork`: each of
+/// them holds a reference to it, and one that writes its page again gets a
+/// slot of its own.
+///
+/// With `-zs`, the pages of the slots are kept compressed in memory, as
+/// long as there is room, and only go to disk when they have not been used
+/// for longest (see `compressed_cache.hh`).
+///
+/// Copyright (c) 2020 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_VMEM_SWAPAREA__HH
+#define NACHOS_VMEM_SWAPAREA__HH
+
+
+#include "compressed_cache.hh"
+#include "filesys/open_file.hh"
+#include "lib/bitmap.hh"
+#include "machine/mmu.hh"
+
+
+/// Number of slots in the swap area.
+const unsigned NUM_SWAP_SLOTS = 8 * NUM_PHYS_PAGES;
+
+class SwapArea {
+public:
+
+    /// Create the swap file `name`, with `size` slots, all of them free,
+    /// and a compressed cache of `cacheFrames` frames in front of it, if
+    /// not zero.
+    SwapArea(const char *name, unsigned size, unsigned cacheFrames = 0);
+
+    /// Remove the swap file.
+    ~SwapArea();
+
+    /// Take a free slot, or `count` free slots in a row, and return the
+    /// (first) one, or -1 if there are none.
+    int Allocate();
+    int AllocateRun(unsigned count);
+
+    /// Add a reference to `slot`, for one more page that it holds.
+    void Share(unsigned slot);
+
+    /// Drop a reference to `slot`; with the last one, the slot is free.
+    void Free(unsigned slot);
+
+    /// Return whether more than one page refers to `slot`.
+    bool IsShared(unsigned slot) const;
+
+    /// Read, or write, the `count` pages in slots `slot` to
+    /// `slot + count - 1`.  Pages on disk are transferred at once.
+    void ReadPages(char *into, unsigned slot, unsigned count);
+    void WritePages(const char *from, unsigned slot, unsigned count);
+
+    /// Return the number of free slots.
+    unsigned CountFree() const;
+
+private:
+
+    char *fileName;
+    OpenFile *file;
+
+    /// Compressed pages in memory, or null.
+    CompressedCache *cache;
+
+    /// Transfer the `count` pages in slots from `slot` to and from disk.
+    void readFromDisk(char *into, unsigned slot, unsigned count);
+    void writeToDisk(const char *from, unsigned slot, unsigned count);
+
+    /// Slots in use, and how many pages refer to each.
+    Bitmap *slots;
+    unsigned *refs;
+    unsigned numSlots;
+};
+
+
+#endif